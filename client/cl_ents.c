@@ -399,6 +399,39 @@ void CL_ParsePacketEntities (qboolean delta)
 }
 
 
+/*
+===============
+CL_AddTrail
+
+Particle trail and light for a model moving from old_origin to origin
+===============
+*/
+void CL_AddTrail (model_t *model, vec3_t old_origin, vec3_t origin, int key)
+{
+	dlight_t	*dl;
+
+	if (model->flags & EF_ROCKET)
+	{
+		R_RocketTrail (old_origin, origin, 0);
+		dl = CL_AllocDlight (key);
+		VectorCopy (origin, dl->origin);
+		dl->radius = 200;
+		dl->die = cl.time + 0.1;
+	}
+	else if (model->flags & EF_GRENADE)
+		R_RocketTrail (old_origin, origin, 1);
+	else if (model->flags & EF_GIB)
+		R_RocketTrail (old_origin, origin, 2);
+	else if (model->flags & EF_ZOMGIB)
+		R_RocketTrail (old_origin, origin, 4);
+	else if (model->flags & EF_TRACER)
+		R_RocketTrail (old_origin, origin, 3);
+	else if (model->flags & EF_TRACER2)
+		R_RocketTrail (old_origin, origin, 5);
+	else if (model->flags & EF_TRACER3)
+		R_RocketTrail (old_origin, origin, 6);
+}
+
 /*
 ===============
 CL_LinkPacketEntities
@@ -416,7 +449,6 @@ void CL_LinkPacketEntities (void)
 	float				autorotate;
 	int					i;
 	int					pnum;
-	dlight_t			*dl;
 
 	pack = &cl.frames[cls.netchan.incoming_sequence&UPDATE_MASK].packet_entities;
 
@@ -524,26 +556,7 @@ void CL_LinkPacketEntities (void)
 				VectorCopy (ent->origin, old_origin);
 				break;
 			}
-		if (model->flags & EF_ROCKET)
-		{
-			R_RocketTrail (old_origin, ent->origin, 0);
-			dl = CL_AllocDlight (s1->number);
-			VectorCopy (ent->origin, dl->origin);
-			dl->radius = 200;
-			dl->die = cl.time + 0.1;
-		}
-		else if (model->flags & EF_GRENADE)
-			R_RocketTrail (old_origin, ent->origin, 1);
-		else if (model->flags & EF_GIB)
-			R_RocketTrail (old_origin, ent->origin, 2);
-		else if (model->flags & EF_ZOMGIB)
-			R_RocketTrail (old_origin, ent->origin, 4);
-		else if (model->flags & EF_TRACER)
-			R_RocketTrail (old_origin, ent->origin, 3);
-		else if (model->flags & EF_TRACER2)
-			R_RocketTrail (old_origin, ent->origin, 5);
-		else if (model->flags & EF_TRACER3)
-			R_RocketTrail (old_origin, ent->origin, 6);
+		CL_AddTrail (model, old_origin, ent->origin, s1->number);
 	}
 }
 
@@ -561,11 +574,13 @@ typedef struct
 	int		modelindex;
 	vec3_t	origin;
 	vec3_t	angles;
+	vec3_t	velocity;
+	qboolean	falling;		// pulled down by gravity
 } projectile_t;
 
-#define	MAX_PROJECTILES	32
 projectile_t	cl_projectiles[MAX_PROJECTILES];
 int				cl_num_projectiles;
+double			cl_projectiletime;	// realtime they were parsed
 
 extern int cl_spikeindex;
 
@@ -578,20 +593,37 @@ void CL_ClearProjectiles (void)
 =====================
 CL_ParseProjectiles
 
-Nails are passed as efficient temporary entities
+Nails are passed as efficient temporary entities, and with full set,
+svc_projectiles passes any missile with its model and velocity
 =====================
 */
-void CL_ParseProjectiles (void)
+void CL_ParseProjectiles (qboolean full)
 {
-	int		i, c, j;
+	int		i, c, j, falling;
+	int		modelindex;
 	byte	bits[6];
+	vec3_t	velocity;
 	projectile_t	*pr;
 
 	c = MSG_ReadByte ();
+	falling = 0;
+	if (full)
+	{
+		falling = MSG_ReadByte ();
+		c += falling;
+	}
+
+	modelindex = cl_spikeindex;
+	VectorCopy (vec3_origin, velocity);
 	for (i=0 ; i<c ; i++)
 	{
+		if (full)
+			modelindex = MSG_ReadByte ();
 		for (j=0 ; j<6 ; j++)
 			bits[j] = MSG_ReadByte ();
+		if (full)
+			for (j=0 ; j<3 ; j++)
+				velocity[j] = MSG_ReadChar () * 16;
 
 		if (cl_num_projectiles == MAX_PROJECTILES)
 			continue;
@@ -599,27 +631,52 @@ void CL_ParseProjectiles (void)
 		pr = &cl_projectiles[cl_num_projectiles];
 		cl_num_projectiles++;
 
-		pr->modelindex = cl_spikeindex;
+		pr->modelindex = modelindex;
 		pr->origin[0] = ( ( bits[0] + ((bits[1]&15)<<8) ) <<1) - 4096;
 		pr->origin[1] = ( ( (bits[1]>>4) + (bits[2]<<4) ) <<1) - 4096;
 		pr->origin[2] = ( ( bits[3] + ((bits[4]&15)<<8) ) <<1) - 4096;
 		pr->angles[0] = 360*(bits[4]>>4)/16;
 		pr->angles[1] = 360*bits[5]/256;
+		VectorCopy (velocity, pr->velocity);
+		pr->falling = i >= c - falling;
 	}
+
+	cl_projectiletime = realtime;
+}
+
+/*
+=============
+CL_ProjectileOrigin
+
+Where a projectile is time seconds after it was parsed
+=============
+*/
+static void CL_ProjectileOrigin (projectile_t *pr, float time, vec3_t origin)
+{
+	VectorMA (pr->origin, time, pr->velocity, origin);
+	if (pr->falling)
+		origin[2] -= 0.5*movevars.gravity*time*time;
 }
 
 /*
 =============
 CL_LinkProjectiles
 
+Moves them on from where the last message had them
 =============
 */
 void CL_LinkProjectiles (void)
 {
 	int		i;
+	float	time;
+	vec3_t	old_origin;
 	projectile_t	*pr;
 	entity_t		*ent;
 
+	time = realtime - cl_projectiletime;
+	if (time > 0.1)
+		time = 0.1;		// don't fly off if messages stop
+
 	for (i=0, pr=cl_projectiles ; i<cl_num_projectiles ; i++, pr++)
 	{
 		// grab an entity to fill in
@@ -636,8 +693,15 @@ void CL_LinkProjectiles (void)
 		ent->frame = 0;
 		ent->colormap = vid.colormap;
 		ent->scoreboard = NULL;
-		VectorCopy (pr->origin, ent->origin);
+		CL_ProjectileOrigin (pr, time, ent->origin);
 		VectorCopy (pr->angles, ent->angles);
+
+		// the trail runs back to where it was last frame
+		if (ent->model && ent->model->flags && (pr->velocity[0] || pr->velocity[1] || pr->velocity[2]))
+		{
+			CL_ProjectileOrigin (pr, time - host_frametime, old_origin);
+			CL_AddTrail (ent->model, old_origin, ent->origin, -1-i);
+		}
 	}
 }
 
@@ -926,6 +990,8 @@ void CL_SetSolidEntities (void)
 			continue;
 		if (!cl.model_precache[state->modelindex])
 			continue;
+		if (pmove.numphysent == MAX_PHYSENTS)
+			break;
 		if ( cl.model_precache[state->modelindex]->hulls[1].firstclipnode 
 			|| cl.model_precache[state->modelindex]->clipbox )
 		{
@@ -1043,6 +1109,9 @@ void CL_SetSolidPlayers (int playernum)
 		if (pplayer->flags & PF_DEAD)
 			continue; // dead players aren't solid
 
+		if (pmove.numphysent == MAX_PHYSENTS)
+			break;
+
 		pent->model = 0;
 		VectorCopy(pplayer->origin, pent->origin);
 		VectorCopy(player_mins, pent->mins);
@@ -80,6 +80,7 @@ cvar_t	bottomcolor = {"bottomcolor","0", true, true};
 cvar_t	rate = {"rate","2500", true, true};
 cvar_t	noaim = {"noaim","0", true, true};
 cvar_t	msg = {"msg","1", true, true};
+cvar_t	proj = {"proj","1", true, true};	// take svc_projectiles
 
 extern cvar_t cl_hightrack;
 
@@ -1063,6 +1064,7 @@ void CL_Init (void)
 	Info_SetValueForKey (cls.userinfo, "bottomcolor", "0", MAX_INFO_STRING);
 	Info_SetValueForKey (cls.userinfo, "rate", "2500", MAX_INFO_STRING);
 	Info_SetValueForKey (cls.userinfo, "msg", "1", MAX_INFO_STRING);
+	Info_SetValueForKey (cls.userinfo, "proj", "1", MAX_INFO_STRING);
 	sprintf (st, "%4.2f-%04d", VERSION, build_number());
 	Info_SetValueForStarKey (cls.userinfo, "*ver", st, MAX_INFO_STRING);
 
@@ -1127,6 +1129,7 @@ void CL_Init (void)
 	Cvar_RegisterVariable (&bottomcolor);
 	Cvar_RegisterVariable (&rate);
 	Cvar_RegisterVariable (&msg);
+	Cvar_RegisterVariable (&proj);
 	Cvar_RegisterVariable (&noaim);
 
 
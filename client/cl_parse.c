@@ -86,7 +86,7 @@ char *svc_strings[] =
 	"svc_setinfo",
 	"svc_serverinfo",
 	"svc_updatepl",
-	"NEW PROTOCOL",
+	"svc_projectiles",
 	"NEW PROTOCOL",
 	"NEW PROTOCOL",
 	"NEW PROTOCOL",
@@ -1333,7 +1333,11 @@ void CL_ParseServerMessage (void)
 			break;
 
 		case svc_nails:
-			CL_ParseProjectiles ();
+			CL_ParseProjectiles (false);
+			break;
+
+		case svc_projectiles:
+			CL_ParseProjectiles (true);
 			break;
 
 		case svc_chokecount:		// some preceding packets were choked
@@ -0,0 +1,504 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// cmodel.c -- hull tracing shared by server physics and player movement
+
+#include "quakedef.h"
+
+#ifdef SERVERONLY
+// the server runs player moves in Sys_RunParallel jobs
+#define	CM_Error	Sys_JobError
+#define	CM_DPrintf	Sys_JobDPrintf
+#else
+#define	CM_Error	Sys_Error
+#define	CM_DPrintf	Con_DPrintf
+#endif
+
+static	FILE	*cm_tracefile;
+static	hull_t	*cm_tracehulls;
+
+/*
+===============================================================================
+
+HULL BOXES
+
+===============================================================================
+*/
+
+/*
+===================
+CM_InitBoxHull
+
+Set up the planes and clipnodes so that the six floats of a bounding box
+can just be stored out and get a proper hull_t structure.
+===================
+*/
+void CM_InitBoxHull (boxhull_t *box)
+{
+	int		i;
+	int		side;
+
+	memset (box, 0, sizeof(*box));
+	box->hull.clipnodes = box->clipnodes;
+	box->hull.planes = box->planes;
+	box->hull.firstclipnode = 0;
+	box->hull.lastclipnode = 5;
+
+	for (i=0 ; i<6 ; i++)
+	{
+		box->clipnodes[i].planenum = i;
+
+		side = i&1;
+
+		box->clipnodes[i].children[side] = CONTENTS_EMPTY;
+		if (i != 5)
+			box->clipnodes[i].children[side^1] = i + 1;
+		else
+			box->clipnodes[i].children[side^1] = CONTENTS_SOLID;
+
+		box->planes[i].type = i>>1;
+		box->planes[i].normal[i>>1] = 1;
+	}
+}
+
+/*
+===================
+CM_HullForBox
+
+To keep everything totally uniform, bounding boxes are turned into small
+BSP trees instead of being compared directly.
+===================
+*/
+hull_t *CM_HullForBox (boxhull_t *box, vec3_t mins, vec3_t maxs)
+{
+	box->planes[0].dist = maxs[0];
+	box->planes[1].dist = mins[0];
+	box->planes[2].dist = maxs[1];
+	box->planes[3].dist = mins[1];
+	box->planes[4].dist = maxs[2];
+	box->planes[5].dist = mins[2];
+
+	return &box->hull;
+}
+
+/*
+===============================================================================
+
+POINT TESTING IN HULLS
+
+===============================================================================
+*/
+
+/*
+==================
+CM_HullPointContents
+
+==================
+*/
+int CM_HullPointContents (hull_t *hull, int num, vec3_t p)
+{
+	float		d;
+	dclipnode_t	*node;
+	mplane_t	*plane;
+
+	while (num >= 0)
+	{
+		if (num < hull->firstclipnode || num > hull->lastclipnode)
+		{
+			CM_Error ("CM_HullPointContents: bad node number");
+			return CONTENTS_SOLID;
+		}
+
+		node = hull->clipnodes + num;
+		plane = hull->planes + node->planenum;
+
+		if (plane->type < 3)
+			d = p[plane->type] - plane->dist;
+		else
+			d = DotProduct (plane->normal, p) - plane->dist;
+		if (d < 0)
+			num = node->children[1];
+		else
+			num = node->children[0];
+	}
+
+	return num;
+}
+
+/*
+===============================================================================
+
+LINE TESTING IN HULLS
+
+===============================================================================
+*/
+
+// 1/32 epsilon to keep floating point happy
+#define	DIST_EPSILON	(0.03125)
+
+/*
+==================
+CM_RecursiveHullCheck
+
+==================
+*/
+qboolean CM_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, hulltrace_t *trace)
+{
+	dclipnode_t	*node;
+	mplane_t	*plane;
+	float		t1, t2;
+	float		frac;
+	int			i;
+	vec3_t		mid;
+	int			side;
+	float		midf;
+
+// check for empty
+	if (num < 0)
+	{
+		if (num != CONTENTS_SOLID)
+		{
+			trace->allsolid = false;
+			if (num == CONTENTS_EMPTY)
+				trace->inopen = true;
+			else
+				trace->inwater = true;
+		}
+		else
+			trace->startsolid = true;
+		return true;		// empty
+	}
+
+	if (num < hull->firstclipnode || num > hull->lastclipnode)
+	{
+		CM_Error ("CM_RecursiveHullCheck: bad node number");
+		return false;
+	}
+
+//
+// find the point distances
+//
+	node = hull->clipnodes + num;
+	plane = hull->planes + node->planenum;
+
+	if (plane->type < 3)
+	{
+		t1 = p1[plane->type] - plane->dist;
+		t2 = p2[plane->type] - plane->dist;
+	}
+	else
+	{
+		t1 = DotProduct (plane->normal, p1) - plane->dist;
+		t2 = DotProduct (plane->normal, p2) - plane->dist;
+	}
+
+	if (t1 >= 0 && t2 >= 0)
+		return CM_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
+	if (t1 < 0 && t2 < 0)
+		return CM_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
+
+// put the crosspoint DIST_EPSILON pixels on the near side
+	if (t1 < 0)
+		frac = (t1 + DIST_EPSILON)/(t1-t2);
+	else
+		frac = (t1 - DIST_EPSILON)/(t1-t2);
+	if (frac < 0)
+		frac = 0;
+	if (frac > 1)
+		frac = 1;
+
+	midf = p1f + (p2f - p1f)*frac;
+	for (i=0 ; i<3 ; i++)
+		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+
+	side = (t1 < 0);
+
+// move up to the node
+	if (!CM_RecursiveHullCheck (hull, node->children[side], p1f, midf, p1, mid, trace) )
+		return false;
+
+	if (CM_HullPointContents (hull, node->children[side^1], mid)
+	!= CONTENTS_SOLID)
+// go past the node
+		return CM_RecursiveHullCheck (hull, node->children[side^1], midf, p2f, mid, p2, trace);
+
+	if (trace->allsolid)
+		return false;		// never got out of the solid area
+
+//==================
+// the other side of the node is solid, this is the impact point
+//==================
+	if (!side)
+	{
+		VectorCopy (plane->normal, trace->plane.normal);
+		trace->plane.dist = plane->dist;
+	}
+	else
+	{
+		VectorSubtract (vec3_origin, plane->normal, trace->plane.normal);
+		trace->plane.dist = -plane->dist;
+	}
+
+	while (CM_HullPointContents (hull, hull->firstclipnode, mid)
+	== CONTENTS_SOLID)
+	{ // shouldn't really happen, but does occasionally
+		frac -= 0.1;
+		if (frac < 0)
+		{
+			trace->fraction = midf;
+			VectorCopy (mid, trace->endpos);
+			CM_DPrintf ("backup past 0\n");
+			return false;
+		}
+		midf = p1f + (p2f - p1f)*frac;
+		for (i=0 ; i<3 ; i++)
+			mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+	}
+
+	trace->fraction = midf;
+	VectorCopy (mid, trace->endpos);
+
+	return false;
+}
+
+
+/*
+==================
+CM_HullCheck
+
+Same trace as CM_RecursiveHullCheck, walked with an explicit stack.
+Descending only ever stacks the far side of a plane the line crosses;
+reaching a leaf resumes the nearest one, and a hit ends the whole trace,
+just as every caller up the recursion returns false once one does.
+==================
+*/
+#define	MAX_HULL_STACK	64
+
+typedef struct
+{
+	int		num, side;
+	float	frac, p1f, midf, p2f;
+	vec3_t	p1, mid, p2;
+} hullframe_t;
+
+qboolean CM_HullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, hulltrace_t *trace)
+{
+	hullframe_t	stack[MAX_HULL_STACK], *f;
+	int			sp, i, side;
+	dclipnode_t	*node;
+	mplane_t	*plane;
+	float		t1, t2, frac, midf;
+	vec3_t		start, end;
+
+	VectorCopy (p1, start);
+	VectorCopy (p2, end);
+	sp = 0;
+
+	for ( ; ; )
+	{
+		while (num >= 0)
+		{
+			if (sp == MAX_HULL_STACK)
+			{	// deeper than any sane map, finish this part recursively
+				if (!CM_RecursiveHullCheck (hull, num, p1f, p2f, start, end, trace))
+					return false;
+				goto resume;
+			}
+
+			if (num < hull->firstclipnode || num > hull->lastclipnode)
+			{
+				CM_Error ("CM_HullCheck: bad node number");
+				return false;
+			}
+
+			node = hull->clipnodes + num;
+			plane = hull->planes + node->planenum;
+
+			if (plane->type < 3)
+			{
+				t1 = start[plane->type] - plane->dist;
+				t2 = end[plane->type] - plane->dist;
+			}
+			else
+			{
+				t1 = DotProduct (plane->normal, start) - plane->dist;
+				t2 = DotProduct (plane->normal, end) - plane->dist;
+			}
+
+			if (t1 >= 0 && t2 >= 0)
+			{
+				num = node->children[0];
+				continue;
+			}
+			if (t1 < 0 && t2 < 0)
+			{
+				num = node->children[1];
+				continue;
+			}
+
+			// put the crosspoint DIST_EPSILON pixels on the near side
+			if (t1 < 0)
+				frac = (t1 + DIST_EPSILON)/(t1-t2);
+			else
+				frac = (t1 - DIST_EPSILON)/(t1-t2);
+			if (frac < 0)
+				frac = 0;
+			if (frac > 1)
+				frac = 1;
+
+			midf = p1f + (p2f - p1f)*frac;
+			side = (t1 < 0);
+
+			// the far side waits while the near side is traced
+			f = &stack[sp++];
+			f->num = num;
+			f->side = side;
+			f->frac = frac;
+			f->p1f = p1f;
+			f->midf = midf;
+			f->p2f = p2f;
+			for (i=0 ; i<3 ; i++)
+			{
+				f->p1[i] = start[i];
+				f->mid[i] = start[i] + frac*(end[i] - start[i]);
+				f->p2[i] = end[i];
+			}
+
+			num = node->children[side];
+			p2f = midf;
+			VectorCopy (f->mid, end);
+		}
+
+		// check for empty
+		if (num != CONTENTS_SOLID)
+		{
+			trace->allsolid = false;
+			if (num == CONTENTS_EMPTY)
+				trace->inopen = true;
+			else
+				trace->inwater = true;
+		}
+		else
+			trace->startsolid = true;
+
+resume:
+		if (!sp)
+			return true;
+		f = &stack[--sp];
+		node = hull->clipnodes + f->num;
+		plane = hull->planes + node->planenum;
+
+		if (CM_HullPointContents (hull, node->children[f->side^1], f->mid)
+		!= CONTENTS_SOLID)
+		{	// go past the node
+			num = node->children[f->side^1];
+			p1f = f->midf;
+			p2f = f->p2f;
+			VectorCopy (f->mid, start);
+			VectorCopy (f->p2, end);
+			continue;
+		}
+
+		if (trace->allsolid)
+			return false;		// never got out of the solid area
+
+		// the other side of the node is solid, this is the impact point
+		if (!f->side)
+		{
+			VectorCopy (plane->normal, trace->plane.normal);
+			trace->plane.dist = plane->dist;
+		}
+		else
+		{
+			VectorSubtract (vec3_origin, plane->normal, trace->plane.normal);
+			trace->plane.dist = -plane->dist;
+		}
+
+		frac = f->frac;
+		midf = f->midf;
+		while (CM_HullPointContents (hull, hull->firstclipnode, f->mid)
+		== CONTENTS_SOLID)
+		{ // shouldn't really happen, but does occasionally
+			frac -= 0.1;
+			if (frac < 0)
+			{
+				trace->fraction = midf;
+				VectorCopy (f->mid, trace->endpos);
+				CM_DPrintf ("backup past 0\n");
+				return false;
+			}
+			midf = f->p1f + (f->p2f - f->p1f)*frac;
+			for (i=0 ; i<3 ; i++)
+				f->mid[i] = f->p1[i] + frac*(f->p2[i] - f->p1[i]);
+		}
+
+		trace->fraction = midf;
+		VectorCopy (f->mid, trace->endpos);
+
+		return false;
+	}
+}
+
+/*
+==================
+CM_HullTrace
+
+The one way the server and player movement trace a line through a hull
+==================
+*/
+void CM_HullTrace (hull_t *hull, vec3_t start, vec3_t end, hulltrace_t *trace)
+{
+	if (cm_tracefile && hull >= cm_tracehulls && hull < cm_tracehulls + MAX_MAP_HULLS)
+		fprintf (cm_tracefile, "%i %.9g %.9g %.9g %.9g %.9g %.9g\n", (int)(hull - cm_tracehulls),
+			start[0], start[1], start[2], end[0], end[1], end[2]);
+
+	memset (trace, 0, sizeof(hulltrace_t));
+	trace->fraction = 1;
+	trace->allsolid = true;
+	VectorCopy (end, trace->endpos);
+	CM_HullCheck (hull, hull->firstclipnode, 0, 1, start, end, trace);
+}
+
+/*
+==================
+CM_HullTraceBatch
+
+Traces count lines through the same hull.  Consecutive lines share the
+upper clipnodes and planes while they are still in the cache, so callers
+with many traces from one spot should hand them over together.
+==================
+*/
+void CM_HullTraceBatch (hull_t *hull, int count, vec3_t *start, vec3_t *end, hulltrace_t *trace)
+{
+	int		i;
+
+	for (i=0 ; i<count ; i++, trace++)
+		CM_HullTrace (hull, start[i], end[i], trace);
+}
+
+/*
+==================
+CM_RecordTraces
+==================
+*/
+void CM_RecordTraces (FILE *f, hull_t *hulls)
+{
+	cm_tracefile = f;
+	cm_tracehulls = hulls;
+}
@@ -0,0 +1,68 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// cmodel.h -- hull tracing shared by server physics and player movement
+
+typedef struct
+{
+	vec3_t	normal;
+	float	dist;
+} plane_t;
+
+typedef struct
+{
+	qboolean	allsolid;	// if true, plane is not valid
+	qboolean	startsolid;	// if true, the initial point was in a solid area
+	qboolean	inopen, inwater;
+	float		fraction;	// time completed, 1.0 = didn't hit anything
+	vec3_t		endpos;		// final position
+	plane_t		plane;		// surface normal at impact
+} hulltrace_t;
+
+// a bounding box turned into a six node hull, one for each user so
+// a box made by one never changes under another
+typedef struct
+{
+	hull_t		hull;
+	dclipnode_t	clipnodes[6];
+	mplane_t	planes[6];
+} boxhull_t;
+
+void CM_InitBoxHull (boxhull_t *box);
+hull_t *CM_HullForBox (boxhull_t *box, vec3_t mins, vec3_t maxs);
+// fills in the planes of box for mins/maxs and returns its hull
+
+int CM_HullPointContents (hull_t *hull, int num, vec3_t p);
+// returns the CONTENTS_* value of the hull leaf p is in, starting at node num
+
+qboolean CM_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, hulltrace_t *trace);
+qboolean CM_HullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, hulltrace_t *trace);
+// trace the part of a line between p1f and p2f through a hull from node num,
+// the second without recursing.  trace must be set up by the caller
+
+void CM_HullTrace (hull_t *hull, vec3_t start, vec3_t end, hulltrace_t *trace);
+// traces start to end through the whole hull into a fresh trace
+
+void CM_HullTraceBatch (hull_t *hull, int count, vec3_t *start, vec3_t *end, hulltrace_t *trace);
+// traces count lines through the same hull into trace[0..count-1]
+
+void CM_RecordTraces (FILE *f, hull_t *hulls);
+// while f is set, every CM_HullTrace through one of the MAX_MAP_HULLS
+// hulls starting at hulls is written to it as a line of
+// hull number, start and end.  NULL stops recording
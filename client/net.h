@@ -41,6 +41,19 @@ void		NET_Shutdown (void);
 qboolean	NET_GetPacket (void);
 void		NET_SendPacket (int length, void *data, netadr_t to);
 
+#define	NET_MAXVEC	4
+typedef struct
+{
+	void	*data;
+	int		length;
+} netvec_t;
+
+void		NET_SendPacketV (netvec_t *vec, int count, netadr_t to);
+// sends count pieces as a single datagram
+void		NET_EnableBatching (qboolean enable);
+void		NET_BeginSendBatch (void);
+void		NET_FlushSendBatch (void);
+
 qboolean	NET_CompareAdr (netadr_t a, netadr_t b);
 qboolean	NET_CompareBaseAdr (netadr_t a, netadr_t b);
 char		*NET_AdrToString (netadr_t a);
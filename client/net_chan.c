@@ -223,7 +223,9 @@ A 0 length will still generate a packet and deal with the reliable messages.
 void Netchan_Transmit (netchan_t *chan, int length, byte *data)
 {
 	sizebuf_t	send;
-	byte		send_buf[MAX_MSGLEN + PACKET_HEADER];
+	byte		send_buf[PACKET_HEADER + 2];
+	netvec_t	vec[3];
+	int			numvec, size;
 	qboolean	send_reliable;
 	unsigned	w1, w2;
 	int			i;
@@ -272,32 +274,49 @@ void Netchan_Transmit (netchan_t *chan, int length, byte *data)
 	MSG_WriteShort (&send, cls.qport);
 #endif
 
-// copy the reliable message to the packet first
+// the header, reliable and unreliable parts go to the socket as they
+// are, without being copied together
+	vec[0].data = send.data;
+	vec[0].length = send.cursize;
+	numvec = 1;
+	size = send.cursize;
+
+// the reliable message goes in the packet first
 	if (send_reliable)
 	{
-		SZ_Write (&send, chan->reliable_buf, chan->reliable_length);
+		if (size + chan->reliable_length > MAX_MSGLEN + PACKET_HEADER)
+			Sys_Error ("Netchan_Transmit: reliable overflow");
+		vec[numvec].data = chan->reliable_buf;
+		vec[numvec].length = chan->reliable_length;
+		numvec++;
+		size += chan->reliable_length;
 		chan->last_reliable_sequence = chan->outgoing_sequence;
 	}
 	
 // add the unreliable part if space is available
-	if (send.maxsize - send.cursize >= length)
-		SZ_Write (&send, data, length);
+	if (MAX_MSGLEN + PACKET_HEADER - size >= length && length)
+	{
+		vec[numvec].data = data;
+		vec[numvec].length = length;
+		numvec++;
+		size += length;
+	}
 
 // send the datagram
 	i = chan->outgoing_sequence & (MAX_LATENT-1);
-	chan->outgoing_size[i] = send.cursize;
+	chan->outgoing_size[i] = size;
 	chan->outgoing_time[i] = realtime;
 
 	//zoid, no input in demo playback mode
 #ifndef SERVERONLY
 	if (!cls.demoplayback)
 #endif
-		NET_SendPacket (send.cursize, send.data, chan->remote_address);
+		NET_SendPacketV (vec, numvec, chan->remote_address);
 
 	if (chan->cleartime < realtime)
-		chan->cleartime = realtime + send.cursize*chan->rate;
+		chan->cleartime = realtime + size*chan->rate;
 	else
-		chan->cleartime += send.cursize*chan->rate;
+		chan->cleartime += size*chan->rate;
 #ifdef SERVERONLY
 	if (ServerPaused())
 		chan->cleartime = realtime;
@@ -309,7 +328,7 @@ void Netchan_Transmit (netchan_t *chan, int length, byte *data)
 			, send_reliable
 			, chan->incoming_sequence
 			, chan->incoming_reliable_sequence
-			, send.cursize);
+			, size);
 
 }
 
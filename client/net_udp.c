@@ -19,6 +19,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 // net_main.c
 
+#ifdef __linux__
+#define _GNU_SOURCE		// recvmmsg / sendmmsg
+#endif
+
 #include "quakedef.h"
 
 #include <sys/types.h>
@@ -31,7 +35,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <arpa/inet.h>
 #include <errno.h>
 
-#if defined(sun) || defined(IRIX)
+#if defined(sun) || defined(IRIX) || defined(__linux__)
 #include <unistd.h>
 #endif
 
@@ -53,9 +57,40 @@ int			net_send_socket;	// blocking, for sends
 #define	MAX_UDP_PACKET	8192
 byte		net_message_buffer[MAX_UDP_PACKET];
 
-// Om varken sun eller IRIX är definierat, använd dessa manuella deklarationer.
+//
+// batched socket layer: a busy server drains every waiting datagram with a
+// single recvmmsg and pushes all of a frame's replies out with a single
+// sendmmsg.  Only compiled where the kernel has the calls, everything else
+// goes through the one packet at a time recvfrom / sendto path.
+//
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+#define	NET_MMSG
+#endif
+
+#define	NET_BATCH		32		// datagrams moved per system call
+
+qboolean	net_batching;		// set by NET_EnableBatching
+
+#ifdef NET_MMSG
+// inbound ring, net_message.data points into it while a packet is processed
+byte		net_ring_buf[NET_BATCH][MAX_UDP_PACKET];
+struct sockaddr_in	net_ring_from[NET_BATCH];
+int			net_ring_len[NET_BATCH];
+int			net_ring_head, net_ring_count;
+
+// outbound queue, filled between NET_BeginSendBatch and NET_FlushSendBatch
+qboolean	net_queueing;
+byte		net_queue_buf[NET_BATCH][MAX_UDP_PACKET];
+struct sockaddr_in	net_queue_to[NET_BATCH];
+int			net_queue_len[NET_BATCH];
+int			net_queue_count;
+
+void NET_SendQueue (void);
+#endif
+
+// Om varken sun, IRIX eller linux är definierat, använd dessa manuella deklarationer.
 // Annars förlitar vi oss på <unistd.h> som inkluderats ovan.
-#if !defined(sun) && !defined(IRIX)
+#if !defined(sun) && !defined(IRIX) && !defined(__linux__)
 int gethostname (char *, int);
 int close (int);
 #endif
@@ -192,12 +227,80 @@ qboolean NET_IsClientLegal(netadr_t *adr)
 
 //=============================================================================
 
+#ifdef NET_MMSG
+/*
+==================
+NET_FillRing
+
+Reads as many waiting datagrams as fit in the ring with one system call.
+Returns false if there was nothing to read.
+==================
+*/
+qboolean NET_FillRing (void)
+{
+	struct mmsghdr	msgs[NET_BATCH];
+	struct iovec	iov[NET_BATCH];
+	int		i, ret;
+
+	memset (msgs, 0, sizeof(msgs));
+	for (i=0 ; i<NET_BATCH ; i++)
+	{
+		iov[i].iov_base = net_ring_buf[i];
+		iov[i].iov_len = MAX_UDP_PACKET;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &net_ring_from[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(net_ring_from[i]);
+	}
+
+	ret = recvmmsg (net_socket, msgs, NET_BATCH, 0, NULL);
+	if (ret == -1) {
+		if (errno == EWOULDBLOCK)
+			return false;
+		if (errno == ECONNREFUSED)
+			return false;
+		if (errno == ENOSYS)
+		{	// old kernel, use the single packet path from now on
+			Con_Printf ("NET_FillRing: recvmmsg not supported, batching disabled\n");
+			net_batching = false;
+			return false;
+		}
+		Sys_Printf ("NET_FillRing: %s\n", strerror(errno));
+		return false;
+	}
+
+	for (i=0 ; i<ret ; i++)
+		net_ring_len[i] = msgs[i].msg_len;
+	net_ring_head = 0;
+	net_ring_count = ret;
+
+	return ret > 0;
+}
+#endif
+
 qboolean NET_GetPacket (void)
 {
 	int 	ret;
 	struct sockaddr_in	from;
 	int		fromlen;
 
+#ifdef NET_MMSG
+	if (net_batching || net_ring_count)
+	{
+		if (!net_ring_count && !NET_FillRing ())
+			return false;
+
+		net_message.data = net_ring_buf[net_ring_head];
+		net_message.cursize = net_ring_len[net_ring_head];
+		SockadrToNetadr (&net_ring_from[net_ring_head], &net_from);
+		net_ring_head++;
+		net_ring_count--;
+
+		return true;
+	}
+	net_message.data = net_message_buffer;
+#endif
+
 	fromlen = sizeof(from);
 	ret = recvfrom (net_socket, net_message_buffer, sizeof(net_message_buffer), 0, (struct sockaddr *)&from, &fromlen);
 	if (ret == -1) {
@@ -222,6 +325,19 @@ void NET_SendPacket (int length, void *data, netadr_t to)
 	int ret;
 	struct sockaddr_in	addr;
 
+#ifdef NET_MMSG
+	if (net_queueing && length <= MAX_UDP_PACKET)
+	{
+		if (net_queue_count == NET_BATCH)
+			NET_SendQueue ();
+		NetadrToSockadr (&to, &net_queue_to[net_queue_count]);
+		memcpy (net_queue_buf[net_queue_count], data, length);
+		net_queue_len[net_queue_count] = length;
+		net_queue_count++;
+		return;
+	}
+#endif
+
 	NetadrToSockadr (&to, &addr);
 
 	ret = sendto (net_socket, data, length, 0, (struct sockaddr *)&addr, sizeof(addr) );
@@ -234,6 +350,176 @@ void NET_SendPacket (int length, void *data, netadr_t to)
 	}
 }
 
+/*
+==================
+NET_SendPacketV
+
+The pieces are handed to the kernel as an iovec instead of being copied
+together first.  While batching they have to be copied into the queue
+anyway, so they are gathered straight into it.
+==================
+*/
+void NET_SendPacketV (netvec_t *vec, int count, netadr_t to)
+{
+	int		i, ret;
+	struct sockaddr_in	addr;
+	struct iovec	iov[NET_MAXVEC];
+	struct msghdr	msg;
+#ifdef NET_MMSG
+	int		length;
+	byte	*buf;
+#endif
+
+	if (count > NET_MAXVEC)
+		Sys_Error ("NET_SendPacketV: %i pieces", count);
+
+#ifdef NET_MMSG
+	if (net_queueing)
+	{
+		for (i=0, length=0 ; i<count ; i++)
+			length += vec[i].length;
+		if (length <= MAX_UDP_PACKET)
+		{
+			if (net_queue_count == NET_BATCH)
+				NET_SendQueue ();
+			NetadrToSockadr (&to, &net_queue_to[net_queue_count]);
+			buf = net_queue_buf[net_queue_count];
+			for (i=0 ; i<count ; i++)
+			{
+				memcpy (buf, vec[i].data, vec[i].length);
+				buf += vec[i].length;
+			}
+			net_queue_len[net_queue_count] = length;
+			net_queue_count++;
+			return;
+		}
+	}
+#endif
+
+	NetadrToSockadr (&to, &addr);
+
+	for (i=0 ; i<count ; i++)
+	{
+		iov[i].iov_base = vec[i].data;
+		iov[i].iov_len = vec[i].length;
+	}
+	memset (&msg, 0, sizeof(msg));
+	msg.msg_name = (void *)&addr;
+	msg.msg_namelen = sizeof(addr);
+	msg.msg_iov = iov;
+	msg.msg_iovlen = count;
+
+	ret = sendmsg (net_socket, &msg, 0);
+	if (ret == -1) {
+		if (errno == EWOULDBLOCK)
+			return;
+		if (errno == ECONNREFUSED)
+			return;
+		Sys_Printf ("NET_SendPacketV: %s\n", strerror(errno));
+	}
+}
+
+/*
+==================
+NET_BeginSendBatch
+
+Holds back everything given to NET_SendPacket until NET_FlushSendBatch,
+so the whole lot can go to the kernel in one call.
+==================
+*/
+void NET_BeginSendBatch (void)
+{
+#ifdef NET_MMSG
+	if (net_batching)
+		net_queueing = true;
+#endif
+}
+
+#ifdef NET_MMSG
+/*
+==================
+NET_SendQueue
+
+Hands every queued datagram to the kernel
+==================
+*/
+void NET_SendQueue (void)
+{
+	struct mmsghdr	msgs[NET_BATCH];
+	struct iovec	iov[NET_BATCH];
+	int		i, ret, sent;
+
+	memset (msgs, 0, sizeof(msgs));
+	for (i=0 ; i<net_queue_count ; i++)
+	{
+		iov[i].iov_base = net_queue_buf[i];
+		iov[i].iov_len = net_queue_len[i];
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &net_queue_to[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(net_queue_to[i]);
+	}
+
+	sent = 0;
+	while (sent < net_queue_count)
+	{
+		ret = sendmmsg (net_socket, msgs + sent, net_queue_count - sent, 0);
+		if (ret == -1)
+		{
+			if (errno == ENOSYS)
+			{	// old kernel, send the rest one at a time
+				net_batching = false;
+				for ( ; sent < net_queue_count ; sent++)
+					sendto (net_socket, net_queue_buf[sent], net_queue_len[sent], 0
+					, (struct sockaddr *)&net_queue_to[sent], sizeof(net_queue_to[sent]));
+				break;
+			}
+			// the datagram at sent failed, report it and skip past it
+			if (errno != EWOULDBLOCK && errno != ECONNREFUSED)
+				Sys_Printf ("NET_SendQueue: %s\n", strerror(errno));
+			sent++;
+			continue;
+		}
+		sent += ret;
+	}
+
+	net_queue_count = 0;
+}
+#endif
+
+/*
+==================
+NET_FlushSendBatch
+
+Sends all queued datagrams and stops queueing
+==================
+*/
+void NET_FlushSendBatch (void)
+{
+#ifdef NET_MMSG
+	NET_SendQueue ();
+	net_queueing = false;
+#endif
+}
+
+/*
+==================
+NET_EnableBatching
+
+The server turns this on so it can use the batched socket calls
+==================
+*/
+void NET_EnableBatching (qboolean enable)
+{
+#ifdef NET_MMSG
+	if (!enable)
+		NET_FlushSendBatch ();
+	net_batching = enable;
+	if (enable)
+		Con_Printf ("UDP batching enabled\n");
+#endif
+}
+
 //=============================================================================
 
 int UDP_OpenSocket (int port)
@@ -317,6 +603,7 @@ NET_Shutdown
 */
 void	NET_Shutdown (void)
 {
+	NET_FlushSendBatch ();
 	close (net_socket);
 }
 
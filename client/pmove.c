@@ -29,10 +29,6 @@ int			onground;
 int			waterlevel;
 int			watertype;
 
-float		frametime;
-
-vec3_t		forward, right, up;
-
 vec3_t	player_mins = {-16, -16, -24};
 vec3_t	player_maxs = {16, 16, 32};
 
@@ -46,11 +42,9 @@ vec3_t	player_maxs = {16, 16, 32};
 // #define	PM_FRICTION			6
 // #define	PM_WATERFRICTION	1
 
-void PM_InitBoxHull (void);
-
 void Pmove_Init (void)
 {
-	PM_InitBoxHull ();
+	CM_InitBoxHull (&pmove.box);
 }
 
 #define	STEPSIZE	18
@@ -104,7 +98,7 @@ The basic solid body movement clip that slides along multiple planes
 */
 #define	MAX_CLIP_PLANES	5
 
-int PM_FlyMove (void)
+int PM_FlyMove (playermove_t *pm)
 {
 	int			bumpcount, numbumps;
 	vec3_t		dir;
@@ -121,28 +115,28 @@ int PM_FlyMove (void)
 	numbumps = 4;
 	
 	blocked = 0;
-	VectorCopy (pmove.velocity, original_velocity);
-	VectorCopy (pmove.velocity, primal_velocity);
+	VectorCopy (pm->velocity, original_velocity);
+	VectorCopy (pm->velocity, primal_velocity);
 	numplanes = 0;
 	
-	time_left = frametime;
+	time_left = pm->frametime;
 
 	for (bumpcount=0 ; bumpcount<numbumps ; bumpcount++)
 	{
 		for (i=0 ; i<3 ; i++)
-			end[i] = pmove.origin[i] + time_left * pmove.velocity[i];
+			end[i] = pm->origin[i] + time_left * pm->velocity[i];
 
-		trace = PM_PlayerMove (pmove.origin, end);
+		trace = PM_PlayerMove (pm, pm->origin, end);
 
 		if (trace.startsolid || trace.allsolid)
 		{	// entity is trapped in another solid
-			VectorCopy (vec3_origin, pmove.velocity);
+			VectorCopy (vec3_origin, pm->velocity);
 			return 3;
 		}
 
 		if (trace.fraction > 0)
 		{	// actually covered some distance
-			VectorCopy (trace.endpos, pmove.origin);
+			VectorCopy (trace.endpos, pm->origin);
 			numplanes = 0;
 		}
 
@@ -150,8 +144,8 @@ int PM_FlyMove (void)
 			 break;		// moved the entire distance
 
 		// save entity for contact
-		pmove.touchindex[pmove.numtouch] = trace.ent;
-		pmove.numtouch++;
+		pm->touchindex[pm->numtouch] = trace.ent;
+		pm->numtouch++;
 
 		if (trace.plane.normal[2] > 0.7)
 		{
@@ -167,7 +161,7 @@ int PM_FlyMove (void)
 	// cliped to another plane
 		if (numplanes >= MAX_CLIP_PLANES)
 		{	// this shouldn't really happen
-			VectorCopy (vec3_origin, pmove.velocity);
+			VectorCopy (vec3_origin, pm->velocity);
 			break;
 		}
 
@@ -179,11 +173,11 @@ int PM_FlyMove (void)
 //
 		for (i=0 ; i<numplanes ; i++)
 		{
-			PM_ClipVelocity (original_velocity, planes[i], pmove.velocity, 1);
+			PM_ClipVelocity (original_velocity, planes[i], pm->velocity, 1);
 			for (j=0 ; j<numplanes ; j++)
 				if (j != i)
 				{
-					if (DotProduct (pmove.velocity, planes[j]) < 0)
+					if (DotProduct (pm->velocity, planes[j]) < 0)
 						break;	// not ok
 				}
 			if (j == numplanes)
@@ -198,28 +192,28 @@ int PM_FlyMove (void)
 			if (numplanes != 2)
 			{
 //				Con_Printf ("clip velocity, numplanes == %i\n",numplanes);
-				VectorCopy (vec3_origin, pmove.velocity);
+				VectorCopy (vec3_origin, pm->velocity);
 				break;
 			}
 			CrossProduct (planes[0], planes[1], dir);
-			d = DotProduct (dir, pmove.velocity);
-			VectorScale (dir, d, pmove.velocity);
+			d = DotProduct (dir, pm->velocity);
+			VectorScale (dir, d, pm->velocity);
 		}
 
 //
 // if original velocity is against the original velocity, stop dead
 // to avoid tiny occilations in sloping corners
 //
-		if (DotProduct (pmove.velocity, primal_velocity) <= 0)
+		if (DotProduct (pm->velocity, primal_velocity) <= 0)
 		{
-			VectorCopy (vec3_origin, pmove.velocity);
+			VectorCopy (vec3_origin, pm->velocity);
 			break;
 		}
 	}
 
-	if (pmove.waterjumptime)
+	if (pm->waterjumptime)
 	{
-		VectorCopy (primal_velocity, pmove.velocity);
+		VectorCopy (primal_velocity, pm->velocity);
 	}
 	return blocked;
 }
@@ -231,68 +225,68 @@ PM_GroundMove
 Player is on ground, with no upwards velocity
 =============
 */
-void PM_GroundMove (void)
+void PM_GroundMove (playermove_t *pm)
 {
 	vec3_t	start, dest;
 	pmtrace_t	trace;
 	vec3_t	original, originalvel, down, up, downvel;
 	float	downdist, updist;
 
-	pmove.velocity[2] = 0;
-	if (!pmove.velocity[0] && !pmove.velocity[1] && !pmove.velocity[2])
+	pm->velocity[2] = 0;
+	if (!pm->velocity[0] && !pm->velocity[1] && !pm->velocity[2])
 		return;
 
 	// first try just moving to the destination	
-	dest[0] = pmove.origin[0] + pmove.velocity[0]*frametime;
-	dest[1] = pmove.origin[1] + pmove.velocity[1]*frametime;	
-	dest[2] = pmove.origin[2];
+	dest[0] = pm->origin[0] + pm->velocity[0]*pm->frametime;
+	dest[1] = pm->origin[1] + pm->velocity[1]*pm->frametime;	
+	dest[2] = pm->origin[2];
 
 	// first try moving directly to the next spot
 	VectorCopy (dest, start);
-	trace = PM_PlayerMove (pmove.origin, dest);
+	trace = PM_PlayerMove (pm, pm->origin, dest);
 	if (trace.fraction == 1)
 	{
-		VectorCopy (trace.endpos, pmove.origin);
+		VectorCopy (trace.endpos, pm->origin);
 		return;
 	}
 
 	// try sliding forward both on ground and up 16 pixels
 	// take the move that goes farthest
-	VectorCopy (pmove.origin, original);
-	VectorCopy (pmove.velocity, originalvel);
+	VectorCopy (pm->origin, original);
+	VectorCopy (pm->velocity, originalvel);
 
 	// slide move
-	PM_FlyMove ();
+	PM_FlyMove (pm);
 
-	VectorCopy (pmove.origin, down);
-	VectorCopy (pmove.velocity, downvel);
+	VectorCopy (pm->origin, down);
+	VectorCopy (pm->velocity, downvel);
 
-	VectorCopy (original, pmove.origin);
-	VectorCopy (originalvel, pmove.velocity);
+	VectorCopy (original, pm->origin);
+	VectorCopy (originalvel, pm->velocity);
 
 // move up a stair height
-	VectorCopy (pmove.origin, dest);
+	VectorCopy (pm->origin, dest);
 	dest[2] += STEPSIZE;
-	trace = PM_PlayerMove (pmove.origin, dest);
+	trace = PM_PlayerMove (pm, pm->origin, dest);
 	if (!trace.startsolid && !trace.allsolid)
 	{
-		VectorCopy (trace.endpos, pmove.origin);
+		VectorCopy (trace.endpos, pm->origin);
 	}
 
 // slide move
-	PM_FlyMove ();
+	PM_FlyMove (pm);
 
 // press down the stepheight
-	VectorCopy (pmove.origin, dest);
+	VectorCopy (pm->origin, dest);
 	dest[2] -= STEPSIZE;
-	trace = PM_PlayerMove (pmove.origin, dest);
+	trace = PM_PlayerMove (pm, pm->origin, dest);
 	if ( trace.plane.normal[2] < 0.7)
 		goto usedown;
 	if (!trace.startsolid && !trace.allsolid)
 	{
-		VectorCopy (trace.endpos, pmove.origin);
+		VectorCopy (trace.endpos, pm->origin);
 	}
-	VectorCopy (pmove.origin, up);
+	VectorCopy (pm->origin, up);
 
 	// decide which one went farther
 	downdist = (down[0] - original[0])*(down[0] - original[0])
@@ -303,10 +297,10 @@ void PM_GroundMove (void)
 	if (downdist > updist)
 	{
 usedown:
-		VectorCopy (down, pmove.origin);
-		VectorCopy (downvel, pmove.velocity);
+		VectorCopy (down, pm->origin);
+		VectorCopy (downvel, pm->velocity);
 	} else // copy z value from slide move
-		pmove.velocity[2] = downvel[2];
+		pm->velocity[2] = downvel[2];
 
 // if at a dead stop, retry the move with nudges to get around lips
 
@@ -321,7 +315,7 @@ PM_Friction
 Handles both ground friction and water friction
 ==================
 */
-void PM_Friction (void)
+void PM_Friction (playermove_t *pm)
 {
 	float	*vel;
 	float	speed, newspeed, control;
@@ -330,10 +324,10 @@ void PM_Friction (void)
 	vec3_t	start, stop;
 	pmtrace_t		trace;
 	
-	if (pmove.waterjumptime)
+	if (pm->waterjumptime)
 		return;
 
-	vel = pmove.velocity;
+	vel = pm->velocity;
 	
 	speed = sqrt(vel[0]*vel[0] +vel[1]*vel[1] + vel[2]*vel[2]);
 	if (speed < 1)
@@ -343,16 +337,16 @@ void PM_Friction (void)
 		return;
 	}
 
-	friction = movevars.friction;
+	friction = pm->movevars->friction;
 
 // if the leading edge is over a dropoff, increase friction
-	if (onground != -1) {
-		start[0] = stop[0] = pmove.origin[0] + vel[0]/speed*16;
-		start[1] = stop[1] = pmove.origin[1] + vel[1]/speed*16;
-		start[2] = pmove.origin[2] + player_mins[2];
+	if (pm->onground != -1) {
+		start[0] = stop[0] = pm->origin[0] + vel[0]/speed*16;
+		start[1] = stop[1] = pm->origin[1] + vel[1]/speed*16;
+		start[2] = pm->origin[2] + player_mins[2];
 		stop[2] = start[2] - 34;
 
-		trace = PM_PlayerMove (start, stop);
+		trace = PM_PlayerMove (pm, start, stop);
 
 		if (trace.fraction == 1) {
 			friction *= 2;
@@ -361,12 +355,12 @@ void PM_Friction (void)
 
 	drop = 0;
 
-	if (waterlevel >= 2) // apply water friction
-		drop += speed*movevars.waterfriction*waterlevel*frametime;
-	else if (onground != -1) // apply ground friction
+	if (pm->waterlevel >= 2) // apply water friction
+		drop += speed*pm->movevars->waterfriction*pm->waterlevel*pm->frametime;
+	else if (pm->onground != -1) // apply ground friction
 	{
-		control = speed < movevars.stopspeed ? movevars.stopspeed : speed;
-		drop += control*friction*frametime;
+		control = speed < pm->movevars->stopspeed ? pm->movevars->stopspeed : speed;
+		drop += control*friction*pm->frametime;
 	}
 
 
@@ -387,50 +381,50 @@ void PM_Friction (void)
 PM_Accelerate
 ==============
 */
-void PM_Accelerate (vec3_t wishdir, float wishspeed, float accel)
+void PM_Accelerate (playermove_t *pm, vec3_t wishdir, float wishspeed, float accel)
 {
 	int			i;
 	float		addspeed, accelspeed, currentspeed;
 
-	if (pmove.dead)
+	if (pm->dead)
 		return;
-	if (pmove.waterjumptime)
+	if (pm->waterjumptime)
 		return;
 
-	currentspeed = DotProduct (pmove.velocity, wishdir);
+	currentspeed = DotProduct (pm->velocity, wishdir);
 	addspeed = wishspeed - currentspeed;
 	if (addspeed <= 0)
 		return;
-	accelspeed = accel*frametime*wishspeed;
+	accelspeed = accel*pm->frametime*wishspeed;
 	if (accelspeed > addspeed)
 		accelspeed = addspeed;
 	
 	for (i=0 ; i<3 ; i++)
-		pmove.velocity[i] += accelspeed*wishdir[i];	
+		pm->velocity[i] += accelspeed*wishdir[i];	
 }
 
-void PM_AirAccelerate (vec3_t wishdir, float wishspeed, float accel)
+void PM_AirAccelerate (playermove_t *pm, vec3_t wishdir, float wishspeed, float accel)
 {
 	int			i;
 	float		addspeed, accelspeed, currentspeed, wishspd = wishspeed;
 		
-	if (pmove.dead)
+	if (pm->dead)
 		return;
-	if (pmove.waterjumptime)
+	if (pm->waterjumptime)
 		return;
 
 	if (wishspd > 30)
 		wishspd = 30;
-	currentspeed = DotProduct (pmove.velocity, wishdir);
+	currentspeed = DotProduct (pm->velocity, wishdir);
 	addspeed = wishspd - currentspeed;
 	if (addspeed <= 0)
 		return;
-	accelspeed = accel * wishspeed * frametime;
+	accelspeed = accel * wishspeed * pm->frametime;
 	if (accelspeed > addspeed)
 		accelspeed = addspeed;
 	
 	for (i=0 ; i<3 ; i++)
-		pmove.velocity[i] += accelspeed*wishdir[i];	
+		pm->velocity[i] += accelspeed*wishdir[i];	
 }
 
 
@@ -441,7 +435,7 @@ PM_WaterMove
 
 ===================
 */
-void PM_WaterMove (void)
+void PM_WaterMove (playermove_t *pm)
 {
 	int		i;
 	vec3_t	wishvel;
@@ -454,44 +448,44 @@ void PM_WaterMove (void)
 // user intentions
 //
 	for (i=0 ; i<3 ; i++)
-		wishvel[i] = forward[i]*pmove.cmd.forwardmove + right[i]*pmove.cmd.sidemove;
+		wishvel[i] = pm->forward[i]*pm->cmd.forwardmove + pm->right[i]*pm->cmd.sidemove;
 
-	if (!pmove.cmd.forwardmove && !pmove.cmd.sidemove && !pmove.cmd.upmove)
+	if (!pm->cmd.forwardmove && !pm->cmd.sidemove && !pm->cmd.upmove)
 		wishvel[2] -= 60;		// drift towards bottom
 	else
-		wishvel[2] += pmove.cmd.upmove;
+		wishvel[2] += pm->cmd.upmove;
 
 	VectorCopy (wishvel, wishdir);
 	wishspeed = VectorNormalize(wishdir);
 
-	if (wishspeed > movevars.maxspeed)
+	if (wishspeed > pm->movevars->maxspeed)
 	{
-		VectorScale (wishvel, movevars.maxspeed/wishspeed, wishvel);
-		wishspeed = movevars.maxspeed;
+		VectorScale (wishvel, pm->movevars->maxspeed/wishspeed, wishvel);
+		wishspeed = pm->movevars->maxspeed;
 	}
 	wishspeed *= 0.7;
 
 //
 // water acceleration
 //
-//	if (pmove.waterjumptime)
-//		Con_Printf ("wm->%f, %f, %f\n", pmove.velocity[0], pmove.velocity[1], pmove.velocity[2]);
-	PM_Accelerate (wishdir, wishspeed, movevars.wateraccelerate);
+//	if (pm->waterjumptime)
+//		Con_Printf ("wm->%f, %f, %f\n", pm->velocity[0], pm->velocity[1], pm->velocity[2]);
+	PM_Accelerate (pm, wishdir, wishspeed, pm->movevars->wateraccelerate);
 
 // assume it is a stair or a slope, so press down from stepheight above
-	VectorMA (pmove.origin, frametime, pmove.velocity, dest);
+	VectorMA (pm->origin, pm->frametime, pm->velocity, dest);
 	VectorCopy (dest, start);
 	start[2] += STEPSIZE + 1;
-	trace = PM_PlayerMove (start, dest);
+	trace = PM_PlayerMove (pm, start, dest);
 	if (!trace.startsolid && !trace.allsolid)	// FIXME: check steep slope?
 	{	// walked up the step
-		VectorCopy (trace.endpos, pmove.origin);
+		VectorCopy (trace.endpos, pm->origin);
 		return;
 	}
 	
-	PM_FlyMove ();
-//	if (pmove.waterjumptime)
-//		Con_Printf ("<-wm%f, %f, %f\n", pmove.velocity[0], pmove.velocity[1], pmove.velocity[2]);
+	PM_FlyMove (pm);
+//	if (pm->waterjumptime)
+//		Con_Printf ("<-wm%f, %f, %f\n", pm->velocity[0], pm->velocity[1], pm->velocity[2]);
 }
 
 
@@ -501,7 +495,7 @@ PM_AirMove
 
 ===================
 */
-void PM_AirMove (void)
+void PM_AirMove (playermove_t *pm)
 {
 	int			i;
 	vec3_t		wishvel;
@@ -509,16 +503,16 @@ void PM_AirMove (void)
 	vec3_t		wishdir;
 	float		wishspeed;
 
-	fmove = pmove.cmd.forwardmove;
-	smove = pmove.cmd.sidemove;
+	fmove = pm->cmd.forwardmove;
+	smove = pm->cmd.sidemove;
 	
-	forward[2] = 0;
-	right[2] = 0;
-	VectorNormalize (forward);
-	VectorNormalize (right);
+	pm->forward[2] = 0;
+	pm->right[2] = 0;
+	VectorNormalize (pm->forward);
+	VectorNormalize (pm->right);
 
 	for (i=0 ; i<2 ; i++)
-		wishvel[i] = forward[i]*fmove + right[i]*smove;
+		wishvel[i] = pm->forward[i]*fmove + pm->right[i]*smove;
 	wishvel[2] = 0;
 
 	VectorCopy (wishvel, wishdir);
@@ -527,41 +521,41 @@ void PM_AirMove (void)
 //
 // clamp to server defined max speed
 //
-	if (wishspeed > movevars.maxspeed)
+	if (wishspeed > pm->movevars->maxspeed)
 	{
-		VectorScale (wishvel, movevars.maxspeed/wishspeed, wishvel);
-		wishspeed = movevars.maxspeed;
+		VectorScale (wishvel, pm->movevars->maxspeed/wishspeed, wishvel);
+		wishspeed = pm->movevars->maxspeed;
 	}
 	
-//	if (pmove.waterjumptime)
-//		Con_Printf ("am->%f, %f, %f\n", pmove.velocity[0], pmove.velocity[1], pmove.velocity[2]);
+//	if (pm->waterjumptime)
+//		Con_Printf ("am->%f, %f, %f\n", pm->velocity[0], pm->velocity[1], pm->velocity[2]);
 
-	if ( onground != -1)
+	if ( pm->onground != -1)
 	{
-		pmove.velocity[2] = 0;
-		PM_Accelerate (wishdir, wishspeed, movevars.accelerate);
-		pmove.velocity[2] -= movevars.entgravity * movevars.gravity * frametime;
-		PM_GroundMove ();
+		pm->velocity[2] = 0;
+		PM_Accelerate (pm, wishdir, wishspeed, pm->movevars->accelerate);
+		pm->velocity[2] -= pm->movevars->entgravity * pm->movevars->gravity * pm->frametime;
+		PM_GroundMove (pm);
 	}
 	else
 	{	// not on ground, so little effect on velocity
-		PM_AirAccelerate (wishdir, wishspeed, movevars.accelerate);
+		PM_AirAccelerate (pm, wishdir, wishspeed, pm->movevars->accelerate);
 
 		// add gravity
-		pmove.velocity[2] -= movevars.entgravity * movevars.gravity * frametime;
+		pm->velocity[2] -= pm->movevars->entgravity * pm->movevars->gravity * pm->frametime;
 
-		PM_FlyMove ();
+		PM_FlyMove (pm);
 
 	}
 
 //Con_Printf("airmove:vec: %4.2f %4.2f %4.2f\n",
-//			pmove.velocity[0],
-//			pmove.velocity[1],
-//			pmove.velocity[2]);
+//			pm->velocity[0],
+//			pm->velocity[1],
+//			pm->velocity[2]);
 //
 
-//	if (pmove.waterjumptime)
-//		Con_Printf ("<-am%f, %f, %f\n", pmove.velocity[0], pmove.velocity[1], pmove.velocity[2]);
+//	if (pm->waterjumptime)
+//		Con_Printf ("<-am%f, %f, %f\n", pm->velocity[0], pm->velocity[1], pm->velocity[2]);
 }
 
 
@@ -571,7 +565,7 @@ void PM_AirMove (void)
 PM_CatagorizePosition
 =============
 */
-void PM_CatagorizePosition (void)
+void PM_CatagorizePosition (playermove_t *pm)
 {
 	vec3_t		point;
 	int			cont;
@@ -581,57 +575,57 @@ void PM_CatagorizePosition (void)
 // is on ground
 
 // see if standing on something solid	
-	point[0] = pmove.origin[0];
-	point[1] = pmove.origin[1];
-	point[2] = pmove.origin[2] - 1;
-	if (pmove.velocity[2] > 180)
+	point[0] = pm->origin[0];
+	point[1] = pm->origin[1];
+	point[2] = pm->origin[2] - 1;
+	if (pm->velocity[2] > 180)
 	{
-		onground = -1;
+		pm->onground = -1;
 	}
 	else
 	{
-		tr = PM_PlayerMove (pmove.origin, point);
+		tr = PM_PlayerMove (pm, pm->origin, point);
 		if ( tr.plane.normal[2] < 0.7)
-			onground = -1;	// too steep
+			pm->onground = -1;	// too steep
 		else
-			onground = tr.ent;
-		if (onground != -1)
+			pm->onground = tr.ent;
+		if (pm->onground != -1)
 		{
-			pmove.waterjumptime = 0;
+			pm->waterjumptime = 0;
 			if (!tr.startsolid && !tr.allsolid)
-				VectorCopy (tr.endpos, pmove.origin);
+				VectorCopy (tr.endpos, pm->origin);
 		}
 
 		// standing on an entity other than the world
 		if (tr.ent > 0)
 		{
-			pmove.touchindex[pmove.numtouch] = tr.ent;
-			pmove.numtouch++;
+			pm->touchindex[pm->numtouch] = tr.ent;
+			pm->numtouch++;
 		}
 	}
 
 //
 // get waterlevel
 //
-	waterlevel = 0;
-	watertype = CONTENTS_EMPTY;
+	pm->waterlevel = 0;
+	pm->watertype = CONTENTS_EMPTY;
 
-	point[2] = pmove.origin[2] + player_mins[2] + 1;	
-	cont = PM_PointContents (point);
+	point[2] = pm->origin[2] + player_mins[2] + 1;	
+	cont = PM_PointContents (pm, point);
 
 	if (cont <= CONTENTS_WATER)
 	{
-		watertype = cont;
-		waterlevel = 1;
-		point[2] = pmove.origin[2] + (player_mins[2] + player_maxs[2])*0.5;
-		cont = PM_PointContents (point);
+		pm->watertype = cont;
+		pm->waterlevel = 1;
+		point[2] = pm->origin[2] + (player_mins[2] + player_maxs[2])*0.5;
+		cont = PM_PointContents (pm, point);
 		if (cont <= CONTENTS_WATER)
 		{
-			waterlevel = 2;
-			point[2] = pmove.origin[2] + 22;
-			cont = PM_PointContents (point);
+			pm->waterlevel = 2;
+			point[2] = pm->origin[2] + 22;
+			cont = PM_PointContents (pm, point);
 			if (cont <= CONTENTS_WATER)
-				waterlevel = 3;
+				pm->waterlevel = 3;
 		}
 	}
 }
@@ -642,45 +636,45 @@ void PM_CatagorizePosition (void)
 JumpButton
 =============
 */
-void JumpButton (void)
+void JumpButton (playermove_t *pm)
 {
-	if (pmove.dead)
+	if (pm->dead)
 	{
-		pmove.oldbuttons |= BUTTON_JUMP;	// don't jump again until released
+		pm->oldbuttons |= BUTTON_JUMP;	// don't jump again until released
 		return;
 	}
 
-	if (pmove.waterjumptime)
+	if (pm->waterjumptime)
 	{
-		pmove.waterjumptime -= frametime;
-		if (pmove.waterjumptime < 0)
-			pmove.waterjumptime = 0;
+		pm->waterjumptime -= pm->frametime;
+		if (pm->waterjumptime < 0)
+			pm->waterjumptime = 0;
 		return;
 	}
 
-	if (waterlevel >= 2)
+	if (pm->waterlevel >= 2)
 	{	// swimming, not jumping
-		onground = -1;
+		pm->onground = -1;
 
-		if (watertype == CONTENTS_WATER)
-			pmove.velocity[2] = 100;
-		else if (watertype == CONTENTS_SLIME)
-			pmove.velocity[2] = 80;
+		if (pm->watertype == CONTENTS_WATER)
+			pm->velocity[2] = 100;
+		else if (pm->watertype == CONTENTS_SLIME)
+			pm->velocity[2] = 80;
 		else
-			pmove.velocity[2] = 50;
+			pm->velocity[2] = 50;
 		return;
 	}
 
-	if (onground == -1)
+	if (pm->onground == -1)
 		return;		// in air, so no effect
 
-	if ( pmove.oldbuttons & BUTTON_JUMP )
+	if ( pm->oldbuttons & BUTTON_JUMP )
 		return;		// don't pogo stick
 
-	onground = -1;
-	pmove.velocity[2] += 270;
+	pm->onground = -1;
+	pm->velocity[2] += 270;
 
-	pmove.oldbuttons |= BUTTON_JUMP;	// don't jump again until released
+	pm->oldbuttons |= BUTTON_JUMP;	// don't jump again until released
 }
 
 /*
@@ -688,66 +682,66 @@ void JumpButton (void)
 CheckWaterJump
 =============
 */
-void CheckWaterJump (void)
+void CheckWaterJump (playermove_t *pm)
 {
 	vec3_t	spot;
 	int		cont;
 	vec3_t	flatforward;
 
-	if (pmove.waterjumptime)
+	if (pm->waterjumptime)
 		return;
 
 	// ZOID, don't hop out if we just jumped in
-	if (pmove.velocity[2] < -180)
+	if (pm->velocity[2] < -180)
 		return; // only hop out if we are moving up
 
 	// see if near an edge
-	flatforward[0] = forward[0];
-	flatforward[1] = forward[1];
+	flatforward[0] = pm->forward[0];
+	flatforward[1] = pm->forward[1];
 	flatforward[2] = 0;
 	VectorNormalize (flatforward);
 
-	VectorMA (pmove.origin, 24, flatforward, spot);
+	VectorMA (pm->origin, 24, flatforward, spot);
 	spot[2] += 8;
-	cont = PM_PointContents (spot);
+	cont = PM_PointContents (pm, spot);
 	if (cont != CONTENTS_SOLID)
 		return;
 	spot[2] += 24;
-	cont = PM_PointContents (spot);
+	cont = PM_PointContents (pm, spot);
 	if (cont != CONTENTS_EMPTY)
 		return;
 	// jump out of water
-	VectorScale (flatforward, 50, pmove.velocity);
-	pmove.velocity[2] = 310;
-	pmove.waterjumptime = 2;	// safety net
-	pmove.oldbuttons |= BUTTON_JUMP;	// don't jump again until released
+	VectorScale (flatforward, 50, pm->velocity);
+	pm->velocity[2] = 310;
+	pm->waterjumptime = 2;	// safety net
+	pm->oldbuttons |= BUTTON_JUMP;	// don't jump again until released
 }
 
 /*
 =================
 NudgePosition
 
-If pmove.origin is in a solid position,
+If pm->origin is in a solid position,
 try nudging slightly on all axis to
 allow for the cut precision of the net coordinates
 =================
 */
-void NudgePosition (void)
+void NudgePosition (playermove_t *pm)
 {
 	vec3_t	base;
 	int		x, y, z;
 	int		i;
 	static int		sign[3] = {0, -1, 1};
 
-	VectorCopy (pmove.origin, base);
+	VectorCopy (pm->origin, base);
 
 	for (i=0 ; i<3 ; i++)
-		pmove.origin[i] = ((int)(pmove.origin[i]*8)) * 0.125;
-//	pmove.origin[2] += 0.124;
+		pm->origin[i] = ((int)(pm->origin[i]*8)) * 0.125;
+//	pm->origin[2] += 0.124;
 
-//	if (pmove.dead)
+//	if (pm->dead)
 //		return;		// might be a squished point, so don'y bother
-//	if (PM_TestPlayerPosition (pmove.origin) )
+//	if (PM_TestPlayerPosition (pm, pm->origin) )
 //		return;
 
 	for (z=0 ; z<=2 ; z++)
@@ -756,15 +750,15 @@ void NudgePosition (void)
 		{
 			for (y=0 ; y<=2 ; y++)
 			{
-				pmove.origin[0] = base[0] + (sign[x] * 1.0/8);
-				pmove.origin[1] = base[1] + (sign[y] * 1.0/8);
-				pmove.origin[2] = base[2] + (sign[z] * 1.0/8);
-				if (PM_TestPlayerPosition (pmove.origin))
+				pm->origin[0] = base[0] + (sign[x] * 1.0/8);
+				pm->origin[1] = base[1] + (sign[y] * 1.0/8);
+				pm->origin[2] = base[2] + (sign[z] * 1.0/8);
+				if (PM_TestPlayerPosition (pm, pm->origin))
 					return;
 			}
 		}
 	}
-	VectorCopy (base, pmove.origin);
+	VectorCopy (base, pm->origin);
 //	Con_DPrintf ("NudgePosition: stuck\n");
 }
 
@@ -773,7 +767,7 @@ void NudgePosition (void)
 SpectatorMove
 ===============
 */
-void SpectatorMove (void)
+void SpectatorMove (playermove_t *pm)
 {
 	float	speed, drop, friction, control, newspeed;
 	float	currentspeed, addspeed, accelspeed;
@@ -788,18 +782,18 @@ void SpectatorMove (void)
 
 	// friction
 
-	speed = Length (pmove.velocity);
+	speed = Length (pm->velocity);
 	if (speed < 1)
 	{
-		VectorCopy (vec3_origin, pmove.velocity)
+		VectorCopy (vec3_origin, pm->velocity)
 	}
 	else
 	{
 		drop = 0;
 
-		friction = movevars.friction*1.5;	// extra friction
-		control = speed < movevars.stopspeed ? movevars.stopspeed : speed;
-		drop += control*friction*frametime;
+		friction = pm->movevars->friction*1.5;	// extra friction
+		control = speed < pm->movevars->stopspeed ? pm->movevars->stopspeed : speed;
+		drop += control*friction*pm->frametime;
 
 		// scale the velocity
 		newspeed = speed - drop;
@@ -807,19 +801,19 @@ void SpectatorMove (void)
 			newspeed = 0;
 		newspeed /= speed;
 
-		VectorScale (pmove.velocity, newspeed, pmove.velocity);
+		VectorScale (pm->velocity, newspeed, pm->velocity);
 	}
 
 	// accelerate
-	fmove = pmove.cmd.forwardmove;
-	smove = pmove.cmd.sidemove;
+	fmove = pm->cmd.forwardmove;
+	smove = pm->cmd.sidemove;
 	
-	VectorNormalize (forward);
-	VectorNormalize (right);
+	VectorNormalize (pm->forward);
+	VectorNormalize (pm->right);
 
 	for (i=0 ; i<3 ; i++)
-		wishvel[i] = forward[i]*fmove + right[i]*smove;
-	wishvel[2] += pmove.cmd.upmove;
+		wishvel[i] = pm->forward[i]*fmove + pm->right[i]*smove;
+	wishvel[2] += pm->cmd.upmove;
 
 	VectorCopy (wishvel, wishdir);
 	wishspeed = VectorNormalize(wishdir);
@@ -827,78 +821,98 @@ void SpectatorMove (void)
 	//
 	// clamp to server defined max speed
 	//
-	if (wishspeed > movevars.spectatormaxspeed)
+	if (wishspeed > pm->movevars->spectatormaxspeed)
 	{
-		VectorScale (wishvel, movevars.spectatormaxspeed/wishspeed, wishvel);
-		wishspeed = movevars.spectatormaxspeed;
+		VectorScale (wishvel, pm->movevars->spectatormaxspeed/wishspeed, wishvel);
+		wishspeed = pm->movevars->spectatormaxspeed;
 	}
 
-	currentspeed = DotProduct(pmove.velocity, wishdir);
+	currentspeed = DotProduct(pm->velocity, wishdir);
 	addspeed = wishspeed - currentspeed;
 	if (addspeed <= 0)
 		return;
-	accelspeed = movevars.accelerate*frametime*wishspeed;
+	accelspeed = pm->movevars->accelerate*pm->frametime*wishspeed;
 	if (accelspeed > addspeed)
 		accelspeed = addspeed;
 	
 	for (i=0 ; i<3 ; i++)
-		pmove.velocity[i] += accelspeed*wishdir[i];	
+		pm->velocity[i] += accelspeed*wishdir[i];	
 
 
 	// move
-	VectorMA (pmove.origin, frametime, pmove.velocity, pmove.origin);
+	VectorMA (pm->origin, pm->frametime, pm->velocity, pm->origin);
 }
 
 /*
 =============
-PlayerMove
+PM_Move
 
 Returns with origin, angles, and velocity modified in place.
 
 Numtouch and touchindex[] will be set if any of the physents
 were contacted during the move.
+
+Everything the move changes is in pm, so moves for different
+players can run at the same time as long as each has its own
+playermove_t and the world is not changed under them.
 =============
 */
-void PlayerMove (void)
+void PM_Move (playermove_t *pm)
 {
-	frametime = pmove.cmd.msec * 0.001;
-	pmove.numtouch = 0;
+	pm->frametime = pm->cmd.msec * 0.001;
+	pm->numtouch = 0;
 
-	AngleVectors (pmove.angles, forward, right, up);
+	AngleVectors (pm->angles, pm->forward, pm->right, pm->up);
 
-	if (pmove.spectator)
+	if (pm->spectator)
 	{
-		SpectatorMove ();
+		SpectatorMove (pm);
 		return;
 	}
 
-	NudgePosition ();
+	NudgePosition (pm);
 
 	// take angles directly from command
-	VectorCopy (pmove.cmd.angles, pmove.angles);
+	VectorCopy (pm->cmd.angles, pm->angles);
 
 	// set onground, watertype, and waterlevel
-	PM_CatagorizePosition ();
+	PM_CatagorizePosition (pm);
 
-	if (waterlevel == 2)
-		CheckWaterJump ();
+	if (pm->waterlevel == 2)
+		CheckWaterJump (pm);
 
-	if (pmove.velocity[2] < 0)
-		pmove.waterjumptime = 0;
+	if (pm->velocity[2] < 0)
+		pm->waterjumptime = 0;
 
-	if (pmove.cmd.buttons & BUTTON_JUMP)
-		JumpButton ();
+	if (pm->cmd.buttons & BUTTON_JUMP)
+		JumpButton (pm);
 	else
-		pmove.oldbuttons &= ~BUTTON_JUMP;
+		pm->oldbuttons &= ~BUTTON_JUMP;
 
-	PM_Friction ();
+	PM_Friction (pm);
 
-	if (waterlevel >= 2)
-		PM_WaterMove ();
+	if (pm->waterlevel >= 2)
+		PM_WaterMove (pm);
 	else
-		PM_AirMove ();
+		PM_AirMove (pm);
 
 	// set onground, watertype, and waterlevel for final spot
-	PM_CatagorizePosition ();
+	PM_CatagorizePosition (pm);
 }
 
+/*
+=============
+PlayerMove
+
+Moves the global pmove with the global movevars
+=============
+*/
+void PlayerMove (void)
+{
+	pmove.movevars = &movevars;
+	PM_Move (&pmove);
+
+	onground = pmove.onground;
+	waterlevel = pmove.waterlevel;
+	watertype = pmove.watertype;
+}
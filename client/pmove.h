@@ -36,7 +36,21 @@ typedef struct
 } pmtrace_t;
 
 
-#define	MAX_PHYSENTS	32
+typedef struct {
+	float	gravity;
+	float	stopspeed;
+	float	maxspeed;
+	float	spectatormaxspeed;
+	float	accelerate;
+	float	airaccelerate;
+	float	wateraccelerate;
+	float	friction;
+	float	waterfriction;
+	float	entgravity;
+} movevars_t;
+
+
+#define	MAX_PHYSENTS	64		// the world, the other players and what's near
 typedef struct
 {
 	vec3_t	origin;
@@ -69,22 +83,18 @@ typedef struct
 	// results
 	int		numtouch;
 	int		touchindex[MAX_PHYSENTS];
+	int		onground;
+	int		waterlevel;
+	int		watertype;
+
+	// scratch for the move, never copy a playermove_t
+	// since box points into itself
+	movevars_t	*movevars;
+	float		frametime;
+	vec3_t		forward, right, up;
+	boxhull_t	box;		// for non-bsp physents
 } playermove_t;
 
-typedef struct {
-	float	gravity;
-	float	stopspeed;
-	float	maxspeed;
-	float	spectatormaxspeed;
-	float	accelerate;
-	float	airaccelerate;
-	float	wateraccelerate;
-	float	friction;
-	float	waterfriction;
-	float	entgravity;
-} movevars_t;
-
-
 extern	movevars_t		movevars;
 extern	playermove_t	pmove;
 extern	int		onground;
@@ -92,10 +102,9 @@ extern	int		waterlevel;
 extern	int		watertype;
 
 void PlayerMove (void);
+void PM_Move (playermove_t *pm);
 void Pmove_Init (void);
 
-int PM_HullPointContents (hull_t *hull, int num, vec3_t p);
-
-int PM_PointContents (vec3_t point);
-qboolean PM_TestPlayerPosition (vec3_t point);
-pmtrace_t PM_PlayerMove (vec3_t start, vec3_t stop);
+int PM_PointContents (playermove_t *pm, vec3_t point);
+qboolean PM_TestPlayerPosition (playermove_t *pm, vec3_t point);
+pmtrace_t PM_PlayerMove (playermove_t *pm, vec3_t start, vec3_t stop);
@@ -128,6 +128,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define svc_setinfo			51		// setinfo on a client
 #define svc_serverinfo		52		// serverinfo
 #define svc_updatepl		53		// [byte] [byte]
+#define	svc_projectiles		54		// [byte] flying [byte] falling, each
+									// [byte] model [48 bits] xyzpy [24 bits] velocity
+
+#define	MAX_PROJECTILES		64		// in one svc_projectiles
 
 
 //==============================================
@@ -76,6 +76,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "menu.h"
 #include "crc.h"
 #include "cdaudio.h"
+#include "cmodel.h"
 #include "pmove.h"
 
 #ifdef GLQUAKE
@@ -85,18 +85,19 @@ mleaf_t *Mod_PointInLeaf (vec3_t p, model_t *model)
 
 /*
 ===================
-Mod_DecompressVis
+Mod_DecompressVisTo
+
+out must hold MAX_MAP_LEAFS/8 bytes
 ===================
 */
-byte *Mod_DecompressVis (byte *in, model_t *model)
+byte *Mod_DecompressVisTo (byte *in, model_t *model, byte *out)
 {
-	static byte	decompressed[MAX_MAP_LEAFS/8];
 	int		c;
-	byte	*out;
+	byte	*decompressed;
 	int		row;
 
 	row = (model->numleafs+7)>>3;	
-	out = decompressed;
+	decompressed = out;
 
 #if 0
 	memcpy (out, in, row);
@@ -132,6 +133,21 @@ byte *Mod_DecompressVis (byte *in, model_t *model)
 	return decompressed;
 }
 
+/*
+===================
+Mod_DecompressVis
+
+Decompresses into one shared buffer, so neither this nor Mod_LeafPVS may
+be called from Sys_RunParallel jobs
+===================
+*/
+byte *Mod_DecompressVis (byte *in, model_t *model)
+{
+	static byte	decompressed[MAX_MAP_LEAFS/8];
+
+	return Mod_DecompressVisTo (in, model, decompressed);
+}
+
 byte *Mod_LeafPVS (mleaf_t *leaf, model_t *model)
 {
 	if (leaf == model->leafs)
@@ -139,6 +155,21 @@ byte *Mod_LeafPVS (mleaf_t *leaf, model_t *model)
 	return Mod_DecompressVis (leaf->compressed_vis, model);
 }
 
+/*
+===================
+Mod_LeafPVSTo
+
+Mod_LeafPVS for callers that can't share its buffer, like the
+Sys_RunParallel jobs
+===================
+*/
+byte *Mod_LeafPVSTo (mleaf_t *leaf, model_t *model, byte *out)
+{
+	if (leaf == model->leafs)
+		return mod_novis;
+	return Mod_DecompressVisTo (leaf->compressed_vis, model, out);
+}
+
 /*
 ===================
 Mod_ClearAll
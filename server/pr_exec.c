@@ -369,6 +369,7 @@ void PR_ExecuteProgram (func_t fnum)
 	edict_t	*ed;
 	int		exitdepth;
 	eval_t	*ptr;
+	double	qcstart;
 
 	if (!fnum || fnum >= progs->numfunctions)
 	{
@@ -385,6 +386,11 @@ void PR_ExecuteProgram (func_t fnum)
 // make a stack frame
 	exitdepth = pr_depth;
 
+	// only the outermost call is timed, builtins can call back in
+	qcstart = 0;
+	if (!exitdepth && sv_profile.value)
+		qcstart = Sys_DoubleTime ();
+
 	s = PR_EnterFunction (f);
 	
 while (1)
@@ -643,7 +649,11 @@ while (1)
 	
 		s = PR_LeaveFunction ();
 		if (pr_depth == exitdepth)
+		{
+			if (qcstart)
+				sv_qctime += Sys_DoubleTime () - qcstart;
 			return;		// all done
+		}
 		break;
 		
 	case OP_STATE:
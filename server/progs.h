@@ -35,7 +35,6 @@ typedef union eval_s
 typedef struct edict_s
 {
 	qboolean	free;
-	link_t		area;				// linked to a division node or leaf
 	
 	int			num_leafs;
 	short		leafnums[MAX_ENT_LEAFS];
@@ -46,7 +45,6 @@ typedef struct edict_s
 	entvars_t	v;					// C exported fields from progs
 // other fields from progs come immediately after
 } edict_t;
-#define	EDICT_FROM_AREA(l) STRUCT_FROM_LINK(l,edict_t,area)
 
 //============================================================================
 
@@ -48,6 +48,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "protocol.h"
 #include "cmd.h"
 #include "model.h"
+#include "cmodel.h"
 #include "crc.h"
 #include "progs.h"
 
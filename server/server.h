@@ -23,7 +23,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define	MAX_MASTERS	8				// max recipients for heartbeat packets
 
-#define	MAX_SIGNON_BUFFERS	8
+#define	MAX_SIGNON			0x10000		// all of a level's signon messages
+#define	SIGNON_CHUNK		(MAX_MSGLEN-64)	// leaves room for the prespawn stufftext
+#define	MAX_SIGNON_CHUNKS	(2*MAX_SIGNON/SIGNON_CHUNK+1)
+
+#define	MAX_LIST_CHUNKS		16			// per soundlist or modellist
+
+typedef struct
+{
+	int			start;				// first list index in the chunk
+	int			offset, size;		// in sv.lists_buf
+} listchunk_t;
 
 typedef enum {
 	ss_dead,			// no map loaded
@@ -82,12 +92,21 @@ typedef struct
 
 	// the signon buffer will be sent to each client as they connect
 	// includes the entity baselines, the static entities, etc
-	// large levels will have >MAX_DATAGRAM sized signons, so 
-	// multiple signon messages are kept
+	// it is built as one block and cut on message boundaries into
+	// chunks that each fit a reliable message
 	sizebuf_t	signon;
+	byte		signon_buf[MAX_SIGNON];
+	int			signon_mark;		// start of the last complete message
 	int			num_signon_buffers;
-	int			signon_buffer_size[MAX_SIGNON_BUFFERS];
-	byte		signon_buffers[MAX_SIGNON_BUFFERS][MAX_DATAGRAM];
+	int			signon_chunk[MAX_SIGNON_CHUNKS+1];	// offsets into signon_buf
+
+	// the soundlist and modellist replies, built once when the level
+	// is spawned for the start indexes clients will ask for
+	sizebuf_t	lists;
+	byte		lists_buf[(MAX_SOUNDS+MAX_MODELS)*MAX_QPATH + 256];
+	int			num_sound_chunks, num_model_chunks;
+	listchunk_t	sound_chunks[MAX_LIST_CHUNKS];
+	listchunk_t	model_chunks[MAX_LIST_CHUNKS];
 } server_t;
 
 
@@ -114,6 +133,8 @@ typedef struct
 
 #define MAX_BACK_BUFFERS 4
 
+#define	MAX_PHYSCACHE	128		// entities kept for pmove, else gathered every time
+
 typedef struct client_s
 {
 	client_state_t	state;
@@ -138,6 +159,14 @@ typedef struct client_s
 	float			maxspeed;			// localized maxspeed
 	float			entgravity;			// localized ent gravity
 
+	// solid non-player entities near the player for pmove, kept until a
+	// solid one is linked or unlinked within physmins/maxs or the player
+	// leaves them
+	qboolean		physvalid;
+	vec3_t			physmins, physmaxs;
+	int				numphysents;
+	short			physents[MAX_PHYSCACHE];
+
 	edict_t			*edict;				// EDICT_NUM(clientnum+1)
 	char			name[32];			// for printing to other people
 										// extracted from userinfo
@@ -189,6 +218,28 @@ typedef struct client_s
 	int				chokecount;
 	int				delta_sequence;		// -1 = no compression
 	netchan_t		netchan;
+	struct client_s	*hashnext;			// svs.clienthash chain
+
+	double			sendtime;			// building and sending this frame
+	double			sendcost;			// smoothed sendtime
+
+	double			entsent[MAX_EDICTS];	// realtime each entity was last in a packet
+	double			lastentsent;		// realtime of the last packet entsent was set for
+
+// sv_adaptiverate pacing
+	double			nextsnapshot;		// no update before this
+	float			snapinterval;
+	int				entbudget;			// packet entities per update
+	float			avgsize;			// bytes per datagram
+	float			loss;				// fraction of updates the client never got
+	float			minping, avgping;	// ack latency, seconds
+	int				lastacked;			// outgoing sequence loss was counted to
+
+	qboolean		projectiles;		// userinfo proj, takes svc_projectiles
+
+	mleaf_t			*leaf;				// leaf of leaforigin, for multicasts
+	vec3_t			leaforigin;
+	int				leafspawncount;		// map leaf is from
 } client_t;
 
 // a client can leave the server in one of four ways:
@@ -213,28 +264,50 @@ typedef struct
 	int		latched_packets;
 } svstats_t;
 
+// tic timing when sys_ticrate runs the physics on a fixed schedule
+typedef struct
+{
+	double	jitter;			// sum of |tic start - deadline|
+	double	maxjitter;
+	int		count;
+	int		skipped;		// tics merged into a longer one instead of caught up
+
+	double	latched_jitter;
+	double	latched_maxjitter;
+	int		latched_skipped;
+} svticstats_t;
+
 // MAX_CHALLENGES is made large to prevent a denial
 // of service attack that could cycle all of them
 // out before legitimate users connected
 #define	MAX_CHALLENGES	1024
+#define	CHALLENGE_HASH_SIZE	1024	// power of two
+#define	CHALLENGE_TIME	60			// seconds a challenge stays good
 
 typedef struct
 {
 	netadr_t	adr;
 	int			challenge;
-	int			time;
+	double		time;
+	int			hashnext;			// index+1 of the next in the chain, 0 = end
 } challenge_t;
 
+// sequenced packets are matched to their client_t through a hash
+// of the base address and qport instead of a scan of every slot
+#define	CLIENT_HASH_SIZE	64		// power of two
+
 typedef struct
 {
 	int			spawncount;			// number of servers spawned since start,
 									// used to check late spawns
 	client_t	clients[MAX_CLIENTS];
+	client_t	*clienthash[CLIENT_HASH_SIZE];	// by base address and qport
 	int			serverflags;		// episode completion information
 	
 	double		last_heartbeat;
 	int			heartbeat_sequence;
 	svstats_t	stats;
+	svticstats_t	ticstats;
 
 	char		info[MAX_SERVERINFO_STRING];
 
@@ -245,6 +318,15 @@ typedef struct
 	byte		log_buf[2][MAX_DATAGRAM];
 
 	challenge_t	challenges[MAX_CHALLENGES];	// to prevent invalid IPs from connecting
+	int			challengehash[CHALLENGE_HASH_SIZE];	// index+1 of the first challenge
+	int			nextchallenge;		// challenges are handed out in a ring
+
+	int			oob_packets;		// connectionless packets received
+	int			oob_limited;		// dropped by sv_oobrate / sv_oobmaxrate
+	int			oob_bad;			// unknown connectionless commands
+
+	int			pvs_hits;			// fat pvs cache, since the map started
+	int			pvs_misses;
 } server_static_t;
 
 //=============================================================================
@@ -316,6 +398,7 @@ typedef struct
 //============================================================================
 
 extern	cvar_t	sv_mintic, sv_maxtic;
+extern	cvar_t	sv_phscache;
 extern	cvar_t	sv_maxspeed;
 
 extern	netadr_t	master_adr[MAX_MASTERS];	// address of the master server
@@ -348,6 +431,8 @@ extern	FILE		*sv_fraglogfile;
 //
 void SV_Shutdown (void);
 void SV_Frame (float time);
+void SV_TicFrame (float time, double tic);
+void SV_TicStats (double late, int skipped);
 void SV_FinalMessage (char *message);
 void SV_DropClient (client_t *drop);
 
@@ -388,6 +473,7 @@ void SV_FlushSignon (void);
 // sv_phys.c
 //
 void SV_ProgStartFrame (void);
+extern	double	sv_fixedtic;
 void SV_Physics (void);
 void SV_CheckVelocity (edict_t *ent);
 void SV_AddGravity (edict_t *ent, float scale);
@@ -416,7 +502,18 @@ void SV_FindModelNumbers (void);
 //
 void SV_ExecuteClientMessage (client_t *cl);
 void SV_UserInit (void);
+void SV_RunMoves (void);
+
+typedef struct
+{
+	int		checked;	// clients whose parallel moves were compared to serial ones
+	int		touched;	// left out for touching another player
+	int		differed;
+} movecheck_t;
+
+extern	movecheck_t	sv_movecheck;		// sv_parallelmove_verify results
 void SV_TogglePause (const char *msg);
+void SV_BuildLists (void);
 
 
 //
@@ -431,10 +528,119 @@ void SV_EndRedirect (void);
 //
 void SV_Status_f (void);
 
+//
+// sv_prof.c
+//
+#define	PROF_FRAME		0		// all of SV_Frame
+#define	PROF_PACKETS	1		// SV_ReadPackets
+#define	PROF_PHYSICS	2		// SV_Physics
+#define	PROF_COMMANDS	3		// console input and Cbuf_Execute
+#define	PROF_SEND		4		// SV_SendClientMessages
+#define	PROF_QC			5		// QuakeC, outermost PR_ExecuteProgram calls
+#define	NUM_PROF		6
+
+#define	PROF_BUCKETS	128
+
+typedef struct
+{
+	int		buckets[PROF_BUCKETS];
+	int		count;
+	double	total;
+	double	max;
+} profhist_t;
+
+extern	cvar_t	sv_profile;
+extern	double	sv_qctime;
+
+void SV_ProfileInit (void);
+void SV_ProfileSample (int phase, double seconds);
+void SV_ProfileFrame (double frametime);
+void SV_ClientSendCost (client_t *cl, double seconds);
+void SVC_Profile (void);
+
 //
 // sv_ents.c
 //
-void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg);
+
+// because there can be a lot of nails, there is a special
+// network protocol for them
+#define	MAX_NAILS	32
+
+#define	FATPVS_MAXLEAFS	16		// a view near more leafs isn't cached
+
+#define	MAX_SHARED_DELTAS	4
+
+// a visible entity competing for a place in the packet
+typedef struct
+{
+	float	priority;
+	int		num;
+} sv_candidate_t;
+
+typedef struct
+{
+	packet_entities_t	*from;		// NULL for a full update
+	int		size;				// -1 if it didn't fit
+	byte	data[MAX_DATAGRAM];
+} sv_shareddelta_t;
+
+// working storage for building one client's entity update.  each
+// Sys_RunParallel worker has its own, so datagrams can be built at once
+typedef struct
+{
+	int		fatbytes;
+	byte	fatpvs[MAX_MAP_LEAFS/8];
+
+	byte	visents[MAX_EDICTS/8];	// entities touching the pvs being gathered
+
+	byte	leafvis[MAX_MAP_LEAFS/8];	// Mod_LeafPVSTo target; Mod_LeafPVS is main thread only
+	short	fatleafs[FATPVS_MAXLEAFS];	// leafs within 8 units of the view
+	int		numfatleafs;		// counts past FATPVS_MAXLEAFS
+
+	int		nails[MAX_NAILS];
+	int		numnails;
+
+	int		projectiles[MAX_PROJECTILES];	// for clients that take them
+	int		numprojectiles;
+
+	sv_candidate_t	candidates[MAX_EDICTS];
+	int		numcandidates;
+
+	// packetentities encodings shared by a group of spectators
+	sv_shareddelta_t	deltas[MAX_SHARED_DELTAS];
+	int		numdeltas;
+	int		nextdelta;
+} sv_scratch_t;
+
+extern	sv_scratch_t	sv_scratch[SYS_MAXTHREADS];
+extern	cvar_t	sv_pvscache;
+
+// what the clients are sent of each non player entity, copied out of
+// the edicts once a frame by SV_ExtractEntities
+#define	SVENT_VISIBLE		1		// has a model to draw
+#define	SVENT_NAIL			2		// can go in a svc_nails
+#define	SVENT_PROJECTILE	4		// can go in a svc_projectiles
+#define	SVENT_FALLING		8		// a projectile gravity pulls down
+
+typedef struct
+{
+	int		numents;				// sv.num_edicts when extracted
+	byte	flags[MAX_EDICTS];		// SVENT_*, 0 for nothing to send
+	entity_state_t	state[MAX_EDICTS];
+	vec3_t	center[MAX_EDICTS];		// middle of the box, for priority
+	byte	packed[MAX_EDICTS][6];	// nail bits of nails and projectiles
+	signed char	velocity[MAX_EDICTS][3];	// velocity/16 of projectiles
+} sv_entframe_t;
+
+extern	sv_entframe_t	sv_entframe;
+
+void SV_ExtractEntities (void);
+
+byte *SV_FatPVS (sv_scratch_t *sc, vec3_t org);
+void SV_AddToFatPVS (sv_scratch_t *sc, vec3_t org, mnode_t *node);
+void SV_GatherEntities (byte *pvs, packet_entities_t *pack, sv_scratch_t *sc, client_t *client, edict_t *viewer);
+void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, sv_scratch_t *sc);
+void SV_WriteEntitiesToSpectators (client_t **clients, sizebuf_t **msgs, int count, sv_scratch_t *sc);
 
 //
 // sv_nchan.c
@@ -396,6 +396,14 @@ void SV_Status_f (void)
 	Con_Printf ("cpu utilization  : %3i%%\n",(int)cpu);
 	Con_Printf ("avg response time: %i ms\n",(int)avg);
 	Con_Printf ("packets/frame    : %5.2f (%d)\n", pak, num_prstr);
+	Con_Printf ("connectionless   : %i (%i limited, %i bad)\n",
+		svs.oob_packets, svs.oob_limited, svs.oob_bad);
+	Con_Printf ("fat pvs cache    : %i hits, %i misses\n",
+		svs.pvs_hits, svs.pvs_misses);
+	if (svs.ticstats.latched_maxjitter)
+		Con_Printf ("tic jitter       : %.2f ms avg, %.2f ms max, %i skipped\n",
+			1000*svs.ticstats.latched_jitter / STATFRAMES,
+			1000*svs.ticstats.latched_maxjitter, svs.ticstats.latched_skipped);
 	
 // min fps lat drp
 	if (sv_redirected != RD_NONE) {
@@ -31,10 +31,9 @@ crosses a waterline.
 =============================================================================
 */
 
-int		fatbytes;
-byte	fatpvs[MAX_MAP_LEAFS/8];
+sv_scratch_t	sv_scratch[SYS_MAXTHREADS];
 
-void SV_AddToFatPVS (vec3_t org, mnode_t *node)
+void SV_AddToFatPVS (sv_scratch_t *sc, vec3_t org, mnode_t *node)
 {
 	int		i;
 	byte	*pvs;
@@ -48,9 +47,9 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 		{
 			if (node->contents != CONTENTS_SOLID)
 			{
-				pvs = Mod_LeafPVS ( (mleaf_t *)node, sv.worldmodel);
-				for (i=0 ; i<fatbytes ; i++)
-					fatpvs[i] |= pvs[i];
+				pvs = Mod_LeafPVSTo ( (mleaf_t *)node, sv.worldmodel, sc->leafvis);
+				for (i=0 ; i<sc->fatbytes ; i++)
+					sc->fatpvs[i] |= pvs[i];
 			}
 			return;
 		}
@@ -63,7 +62,184 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 			node = node->children[1];
 		else
 		{	// go down both
-			SV_AddToFatPVS (org, node->children[0]);
+			SV_AddToFatPVS (sc, org, node->children[0]);
+			node = node->children[1];
+		}
+	}
+}
+
+/*
+=============================================================================
+
+The fat PVS only depends on which leafs are within 8 units of the view, so
+it is cached under that list of leafs.  Players bunched around the same
+spot, or standing still, find theirs there instead of or-ing the leaf
+PVSs together again.  sv_pvscache is the memory the cache may use in
+kilobytes; when it is full the least recently used entry goes.
+
+=============================================================================
+*/
+
+cvar_t	sv_pvscache = {"sv_pvscache", "512"};
+
+#define	PVSCACHE_HASH	256
+
+typedef struct pvscache_s
+{
+	struct pvscache_s	*hashnext;
+	struct pvscache_s	*prev, *next;	// most recently used first
+	unsigned	hash;
+	int			numleafs;		// -1 if unused
+	short		leafs[FATPVS_MAXLEAFS];
+	byte		*pvs;
+} pvscache_t;
+
+static struct
+{
+	byte		*mem;
+	int			spawncount;		// map the entries are for
+	int			size;			// sv_pvscache they were made for
+	pvscache_t	*hash[PVSCACHE_HASH];
+	pvscache_t	lru;
+} pvscache;
+
+/*
+=============
+SV_FlushPVSCache
+=============
+*/
+static void SV_FlushPVSCache (void)
+{
+	int		i, size, count;
+	byte	*p;
+	pvscache_t	*c;
+
+	if (pvscache.mem)
+		free (pvscache.mem);
+	pvscache.mem = NULL;
+	memset (pvscache.hash, 0, sizeof(pvscache.hash));
+	pvscache.lru.prev = pvscache.lru.next = &pvscache.lru;
+	pvscache.spawncount = svs.spawncount;
+	pvscache.size = (int)sv_pvscache.value;
+	svs.pvs_hits = svs.pvs_misses = 0;
+
+	size = (sizeof(pvscache_t) + ((sv.worldmodel->numleafs+31)>>3) + 7) & ~7;
+	count = pvscache.size * 1024 / size;
+	if (count < 1)
+		return;
+	pvscache.mem = malloc (count*size);
+	if (!pvscache.mem)
+		return;		// run without it
+
+	for (i=0, p=pvscache.mem ; i<count ; i++, p+=size)
+	{
+		c = (pvscache_t *)p;
+		c->pvs = p + sizeof(pvscache_t);
+		c->numleafs = -1;
+		c->hashnext = NULL;
+		c->next = &pvscache.lru;
+		c->prev = pvscache.lru.prev;
+		c->prev->next = c;
+		pvscache.lru.prev = c;
+	}
+}
+
+/*
+=============
+SV_FindPVSCache
+
+Moves the entry for the scratch's fatleafs to the front, if there is one
+=============
+*/
+static pvscache_t *SV_FindPVSCache (sv_scratch_t *sc, unsigned hash)
+{
+	pvscache_t	*c;
+
+	for (c = pvscache.hash[hash & (PVSCACHE_HASH-1)] ; c ; c = c->hashnext)
+	{
+		if (c->hash != hash || c->numleafs != sc->numfatleafs
+		|| memcmp (c->leafs, sc->fatleafs, sc->numfatleafs*sizeof(short)))
+			continue;
+
+		c->prev->next = c->next;
+		c->next->prev = c->prev;
+		c->next = pvscache.lru.next;
+		c->prev = &pvscache.lru;
+		c->next->prev = c;
+		pvscache.lru.next = c;
+		return c;
+	}
+	return NULL;
+}
+
+/*
+=============
+SV_StorePVSCache
+
+Puts the scratch's fatpvs in place of the least recently used entry
+=============
+*/
+static void SV_StorePVSCache (sv_scratch_t *sc, unsigned hash)
+{
+	pvscache_t	*c, **link;
+
+	c = pvscache.lru.prev;
+	if (c->numleafs != -1)
+	{
+		for (link = &pvscache.hash[c->hash & (PVSCACHE_HASH-1)] ; *link != c ; link = &(*link)->hashnext)
+			;
+		*link = c->hashnext;
+	}
+
+	c->hash = hash;
+	c->numleafs = sc->numfatleafs;
+	memcpy (c->leafs, sc->fatleafs, sc->numfatleafs*sizeof(short));
+	memcpy (c->pvs, sc->fatpvs, sc->fatbytes);
+	c->hashnext = pvscache.hash[hash & (PVSCACHE_HASH-1)];
+	pvscache.hash[hash & (PVSCACHE_HASH-1)] = c;
+
+	c->prev->next = c->next;
+	c->next->prev = c->prev;
+	c->next = pvscache.lru.next;
+	c->prev = &pvscache.lru;
+	c->next->prev = c;
+	pvscache.lru.next = c;
+}
+
+/*
+=============
+SV_FatLeafs
+
+Lists the leafs SV_AddToFatPVS would or together
+=============
+*/
+static void SV_FatLeafs (sv_scratch_t *sc, vec3_t org, mnode_t *node)
+{
+	mplane_t	*plane;
+	float	d;
+
+	while (1)
+	{
+		if (node->contents < 0)
+		{
+			if (node->contents != CONTENTS_SOLID)
+			{
+				if (sc->numfatleafs < FATPVS_MAXLEAFS)
+					sc->fatleafs[sc->numfatleafs] = (mleaf_t *)node - sv.worldmodel->leafs;
+				sc->numfatleafs++;
+			}
+			return;
+		}
+	
+		plane = node->plane;
+		d = DotProduct (org, plane->normal) - plane->dist;
+		if (d > 8)
+			node = node->children[0];
+		else if (d < -8)
+			node = node->children[1];
+		else
+		{	// go down both
+			SV_FatLeafs (sc, org, node->children[0]);
 			node = node->children[1];
 		}
 	}
@@ -77,68 +253,279 @@ Calculates a PVS that is the inclusive or of all leafs within 8 pixels of the
 given point.
 =============
 */
-byte *SV_FatPVS (vec3_t org)
+byte *SV_FatPVS (sv_scratch_t *sc, vec3_t org)
 {
-	fatbytes = (sv.worldmodel->numleafs+31)>>3;
-	Q_memset (fatpvs, 0, fatbytes);
-	SV_AddToFatPVS (org, sv.worldmodel->nodes);
-	return fatpvs;
+	int		i, j;
+	unsigned	hash;
+	byte	*pvs;
+	pvscache_t	*c;
+
+	sc->fatbytes = (sv.worldmodel->numleafs+31)>>3;
+
+	sc->numfatleafs = 0;
+	if (sv_pvscache.value)
+		SV_FatLeafs (sc, org, sv.worldmodel->nodes);
+	if (!sc->numfatleafs || sc->numfatleafs > FATPVS_MAXLEAFS)
+	{	// not cached
+		Q_memset (sc->fatpvs, 0, sc->fatbytes);
+		SV_AddToFatPVS (sc, org, sv.worldmodel->nodes);
+		return sc->fatpvs;
+	}
+
+	hash = 0;
+	for (i=0 ; i<sc->numfatleafs ; i++)
+		hash = hash*31 + sc->fatleafs[i];
+
+	Sys_Lock ();
+	if (pvscache.spawncount != svs.spawncount || pvscache.size != (int)sv_pvscache.value)
+		SV_FlushPVSCache ();
+	c = SV_FindPVSCache (sc, hash);
+	if (c)
+	{
+		memcpy (sc->fatpvs, c->pvs, sc->fatbytes);
+		svs.pvs_hits++;
+		Sys_Unlock ();
+		return sc->fatpvs;
+	}
+	svs.pvs_misses++;
+	Sys_Unlock ();
+
+	Q_memset (sc->fatpvs, 0, sc->fatbytes);
+	for (i=0 ; i<sc->numfatleafs ; i++)
+	{
+		pvs = Mod_LeafPVSTo (sv.worldmodel->leafs + sc->fatleafs[i], sv.worldmodel, sc->leafvis);
+		for (j=0 ; j<sc->fatbytes ; j++)
+			sc->fatpvs[j] |= pvs[j];
+	}
+
+	// another worker may have stored the same view meanwhile
+	Sys_Lock ();
+	if (pvscache.mem && !SV_FindPVSCache (sc, hash))
+		SV_StorePVSCache (sc, hash);
+	Sys_Unlock ();
+
+	return sc->fatpvs;
 }
 
 //=============================================================================
 
-// because there can be a lot of nails, there is a special
-// network protocol for them
-#define	MAX_NAILS	32
-edict_t	*nails[MAX_NAILS];
-int		numnails;
-
 extern	int	sv_nailmodel, sv_supernailmodel, sv_playermodel;
+extern	cvar_t	sv_adaptiverate;
 
-qboolean SV_AddNailUpdate (edict_t *ent)
+/*
+=============================================================================
+
+The fields sent for the non player entities are copied out of the edicts
+once a frame, just before the client updates are built, so that each
+client walks a byte of flags per entity instead of every entvars_t, and
+the model string and projectile tests are done once rather than once per
+client.
+
+=============================================================================
+*/
+
+sv_entframe_t	sv_entframe;
+
+/*
+=============
+SV_PackProjectile
+
+[48 bits] xyzpy 12 12 12 4 8
+=============
+*/
+static void SV_PackProjectile (edict_t *ent, byte *bits)
+{
+	int		x, y, z, p, yaw;
+
+	x = (int)(ent->v.origin[0]+4096)>>1;
+	y = (int)(ent->v.origin[1]+4096)>>1;
+	z = (int)(ent->v.origin[2]+4096)>>1;
+	p = (int)(16*ent->v.angles[0]/360)&15;
+	yaw = (int)(256*ent->v.angles[1]/360)&255;
+
+	bits[0] = x;
+	bits[1] = (x>>8) | (y<<4);
+	bits[2] = (y>>4);
+	bits[3] = z;
+	bits[4] = (z>>8) | (p<<4);
+	bits[5] = yaw;
+}
+
+/*
+=============
+SV_IsProjectile
+
+Missiles and thrown things are sent to clients that take svc_projectiles
+in a short form, without a delta, and moved along their velocity by the
+client.  Anything the short form can't carry stays a packet entity.
+=============
+*/
+static qboolean SV_IsProjectile (edict_t *ent)
 {
-	if (ent->v.modelindex != sv_nailmodel
-		&& ent->v.modelindex != sv_supernailmodel)
+	int		i;
+
+	if (ent->v.movetype != MOVETYPE_FLYMISSILE
+		&& ent->v.movetype != MOVETYPE_TOSS
+		&& ent->v.movetype != MOVETYPE_BOUNCE)
 		return false;
-	if (numnails == MAX_NAILS)
-		return true;
-	nails[numnails] = ent;
-	numnails++;
+
+	if (ent->v.modelindex > 255 || ent->v.frame || ent->v.skin
+		|| ent->v.effects || ent->v.colormap
+		|| ((int)ent->v.flags & FL_ITEM) || *PR_GetString(ent->v.model) == '*')
+		return false;
+	for (i=0 ; i<3 ; i++)
+		if (ent->v.origin[i] < -4096 || ent->v.origin[i] >= 4096)
+			return false;
 	return true;
 }
 
-void SV_EmitNailUpdate (sizebuf_t *msg)
+/*
+=============
+SV_ExtractEntities
+
+Called by SV_SendClientMessages before any updates are built
+=============
+*/
+void SV_ExtractEntities (void)
 {
-	byte	bits[6];	// [48 bits] xyzpy 12 12 12 4 8 
-	int		n, i;
+	int		e, i, v, flags;
 	edict_t	*ent;
-	int		x, y, z, p, yaw;
+	entity_state_t	*state;
+
+	sv_entframe.numents = sv.num_edicts;
+	for (e=MAX_CLIENTS+1 ; e<sv.num_edicts ; e++)
+	{
+		ent = EDICT_NUM(e);
+
+		// ignore ents without visible models
+		if (!ent->v.modelindex || !*PR_GetString(ent->v.model))
+		{
+			sv_entframe.flags[e] = 0;
+			continue;
+		}
+
+		state = &sv_entframe.state[e];
+		state->number = e;
+		state->flags = 0;
+		VectorCopy (ent->v.origin, state->origin);
+		VectorCopy (ent->v.angles, state->angles);
+		state->modelindex = ent->v.modelindex;
+		state->frame = ent->v.frame;
+		state->colormap = ent->v.colormap;
+		state->skinnum = ent->v.skin;
+		state->effects = ent->v.effects;
+
+		// brush models have their origin at the world's, so use the box
+		for (i=0 ; i<3 ; i++)
+			sv_entframe.center[e][i] = (ent->v.absmin[i] + ent->v.absmax[i])*0.5;
+
+		flags = SVENT_VISIBLE;
+		if (ent->v.modelindex == sv_nailmodel
+			|| ent->v.modelindex == sv_supernailmodel)
+			flags |= SVENT_NAIL;
+		if (SV_IsProjectile (ent))
+		{
+			flags |= SVENT_PROJECTILE;
+			if (ent->v.movetype != MOVETYPE_FLYMISSILE
+				&& !((int)ent->v.flags & FL_ONGROUND))
+				flags |= SVENT_FALLING;
+			for (i=0 ; i<3 ; i++)
+			{
+				v = (int)ent->v.velocity[i] / 16;
+				if (v > 127)
+					v = 127;
+				else if (v < -127)
+					v = -127;
+				sv_entframe.velocity[e][i] = v;
+			}
+		}
+		if (flags & (SVENT_NAIL|SVENT_PROJECTILE))
+			SV_PackProjectile (ent, sv_entframe.packed[e]);
+
+		sv_entframe.flags[e] = flags;
+	}
+}
+
+//=============================================================================
+
+qboolean SV_AddNailUpdate (sv_scratch_t *sc, int e)
+{
+	if (!(sv_entframe.flags[e] & SVENT_NAIL))
+		return false;
+	if (sc->numnails == MAX_NAILS)
+		return true;
+	sc->nails[sc->numnails] = e;
+	sc->numnails++;
+	return true;
+}
 
-	if (!numnails)
+void SV_EmitNailUpdate (sv_scratch_t *sc, sizebuf_t *msg)
+{
+	int		n;
+
+	if (!sc->numnails)
 		return;
 
 	MSG_WriteByte (msg, svc_nails);
-	MSG_WriteByte (msg, numnails);
+	MSG_WriteByte (msg, sc->numnails);
 
-	for (n=0 ; n<numnails ; n++)
-	{
-		ent = nails[n];
-		x = (int)(ent->v.origin[0]+4096)>>1;
-		y = (int)(ent->v.origin[1]+4096)>>1;
-		z = (int)(ent->v.origin[2]+4096)>>1;
-		p = (int)(16*ent->v.angles[0]/360)&15;
-		yaw = (int)(256*ent->v.angles[1]/360)&255;
-
-		bits[0] = x;
-		bits[1] = (x>>8) | (y<<4);
-		bits[2] = (y>>4);
-		bits[3] = z;
-		bits[4] = (z>>8) | (p<<4);
-		bits[5] = yaw;
-
-		for (i=0 ; i<6 ; i++)
-			MSG_WriteByte (msg, bits[i]);
-	}
+	for (n=0 ; n<sc->numnails ; n++)
+		SZ_Write (msg, sv_entframe.packed[sc->nails[n]], 6);
+}
+
+/*
+=============
+SV_AddProjectile
+=============
+*/
+qboolean SV_AddProjectile (sv_scratch_t *sc, int e)
+{
+	if (!(sv_entframe.flags[e] & SVENT_PROJECTILE))
+		return false;
+	if (sc->numprojectiles == MAX_PROJECTILES)
+		return false;
+
+	sc->projectiles[sc->numprojectiles] = e;
+	sc->numprojectiles++;
+	return true;
+}
+
+/*
+=============
+SV_EmitProjectileUpdate
+
+The ones in flight first, then the falling ones, each as
+[byte] model, the nail bits and velocity/16 in three signed bytes
+=============
+*/
+void SV_EmitProjectileUpdate (sv_scratch_t *sc, sizebuf_t *msg)
+{
+	int		n, i, e, falling, pass;
+
+	if (!sc->numprojectiles)
+		return;
+
+	falling = 0;
+	for (n=0 ; n<sc->numprojectiles ; n++)
+		if (sv_entframe.flags[sc->projectiles[n]] & SVENT_FALLING)
+			falling++;
+
+	MSG_WriteByte (msg, svc_projectiles);
+	MSG_WriteByte (msg, sc->numprojectiles - falling);
+	MSG_WriteByte (msg, falling);
+
+	for (pass=0 ; pass<2 ; pass++)
+		for (n=0 ; n<sc->numprojectiles ; n++)
+		{
+			e = sc->projectiles[n];
+			if (!!(sv_entframe.flags[e] & SVENT_FALLING) != pass)
+				continue;
+
+			MSG_WriteByte (msg, sv_entframe.state[e].modelindex);
+			SZ_Write (msg, sv_entframe.packed[e], 6);
+			for (i=0 ; i<3 ; i++)
+				MSG_WriteChar (msg, sv_entframe.velocity[e][i]);
+		}
 }
 
 //=============================================================================
@@ -241,38 +628,19 @@ void SV_WriteDelta (entity_state_t *from, entity_state_t *to, sizebuf_t *msg, qb
 
 /*
 =============
-SV_EmitPacketEntities
-
-Writes a delta update of a packet_entities_t to the message.
+SV_WritePacketEntitiesDelta
 
+The body of a packetentities message, from is NULL for a full update
 =============
 */
-void SV_EmitPacketEntities (client_t *client, packet_entities_t *to, sizebuf_t *msg)
+void SV_WritePacketEntitiesDelta (packet_entities_t *from, packet_entities_t *to, sizebuf_t *msg)
 {
 	edict_t	*ent;
-	client_frame_t	*fromframe;
-	packet_entities_t *from;
 	int		oldindex, newindex;
 	int		oldnum, newnum;
 	int		oldmax;
 
-	// this is the frame that we are going to delta update from
-	if (client->delta_sequence != -1)
-	{
-		fromframe = &client->frames[client->delta_sequence & UPDATE_MASK];
-		from = &fromframe->entities;
-		oldmax = from->num_entities;
-
-		MSG_WriteByte (msg, svc_deltapacketentities);
-		MSG_WriteByte (msg, client->delta_sequence);
-	}
-	else
-	{
-		oldmax = 0;	// no delta update
-		from = NULL;
-
-		MSG_WriteByte (msg, svc_packetentities);
-	}
+	oldmax = from ? from->num_entities : 0;
 
 	newindex = 0;
 	oldindex = 0;
@@ -313,6 +681,96 @@ void SV_EmitPacketEntities (client_t *client, packet_entities_t *to, sizebuf_t *
 	MSG_WriteShort (msg, 0);	// end of packetentities
 }
 
+/*
+=============
+SV_EmitPacketEntitiesHeader
+
+Returns the entities the client will delta from, or NULL
+=============
+*/
+packet_entities_t *SV_EmitPacketEntitiesHeader (client_t *client, sizebuf_t *msg)
+{
+	// this is the frame that we are going to delta update from
+	if (client->delta_sequence != -1)
+	{
+		MSG_WriteByte (msg, svc_deltapacketentities);
+		MSG_WriteByte (msg, client->delta_sequence);
+		return &client->frames[client->delta_sequence & UPDATE_MASK].entities;
+	}
+
+	MSG_WriteByte (msg, svc_packetentities);
+	return NULL;
+}
+
+/*
+=============
+SV_EmitPacketEntities
+
+Writes a delta update of a packet_entities_t to the message.
+
+=============
+*/
+void SV_EmitPacketEntities (client_t *client, packet_entities_t *to, sizebuf_t *msg)
+{
+	packet_entities_t *from;
+
+	from = SV_EmitPacketEntitiesHeader (client, msg);
+	SV_WritePacketEntitiesDelta (from, to, msg);
+}
+
+/*
+=============
+SV_EmitSharedPacketEntities
+
+Like SV_EmitPacketEntities, but the encoded delta is remembered in the
+scratch so the next spectator of the group that deltas from the same
+entities gets a copy instead of a new encoding
+=============
+*/
+void SV_EmitSharedPacketEntities (client_t *client, packet_entities_t *to, sizebuf_t *msg, sv_scratch_t *sc)
+{
+	packet_entities_t *from;
+	sv_shareddelta_t	*d;
+	sizebuf_t	buf;
+	int			i;
+
+	from = SV_EmitPacketEntitiesHeader (client, msg);
+
+	for (i=0, d=sc->deltas ; i<sc->numdeltas ; i++, d++)
+	{
+		if (d->size < 0 || !from != !d->from)
+			continue;
+		if (from && (from->num_entities != d->from->num_entities
+			|| memcmp (from->entities, d->from->entities, from->num_entities*sizeof(entity_state_t))))
+			continue;
+		SZ_Write (msg, d->data, d->size);
+		return;
+	}
+
+	// encode it once more and keep it
+	if (sc->numdeltas < MAX_SHARED_DELTAS)
+		d = &sc->deltas[sc->numdeltas++];
+	else
+		d = &sc->deltas[sc->nextdelta++ % MAX_SHARED_DELTAS];
+
+	buf.data = d->data;
+	buf.maxsize = sizeof(d->data);
+	buf.cursize = 0;
+	buf.allowoverflow = true;
+	buf.overflowed = false;
+	SV_WritePacketEntitiesDelta (from, to, &buf);
+	if (buf.overflowed)
+	{	// can't be shared, let it overflow the real message
+		d->size = -1;
+		SV_WritePacketEntitiesDelta (from, to, msg);
+		return;
+	}
+
+	d->from = from;
+	d->size = buf.cursize;
+	SZ_Write (msg, d->data, d->size);
+}
+
 /*
 =============
 SV_WritePlayersToClient
@@ -442,18 +900,18 @@ Encodes the current state of the world as
 a svc_packetentities messages and possibly
 a svc_nails message and
 svc_playerinfo messages
+
+Only reads shared state, so it can run for several clients at once
+as long as each call has its own scratch
 =============
 */
-void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg)
+void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, sv_scratch_t *sc)
 {
-	int		e, i;
 	byte	*pvs;
 	vec3_t	org;
-	edict_t	*ent;
 	packet_entities_t	*pack;
 	edict_t	*clent;
 	client_frame_t	*frame;
-	entity_state_t	*state;
 
 	// this is the frame we are creating
 	frame = &client->frames[client->netchan.incoming_sequence & UPDATE_MASK];
@@ -461,57 +919,238 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg)
 	// find the client's PVS
 	clent = client->edict;
 	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org);
+	pvs = SV_FatPVS (sc, org);
 
 	// send over the players in the PVS
 	SV_WritePlayersToClient (client, clent, pvs, msg);
 	
 	// put other visible entities into either a packet_entities or a nails message
 	pack = &frame->entities;
-	pack->num_entities = 0;
+	SV_GatherEntities (pvs, pack, sc, client, clent);
+
+	// encode the packet entities as a delta from the
+	// last packetentities acknowledged by the client
+
+	SV_EmitPacketEntities (client, pack, msg);
+
+	// now add the specialized nail and projectile updates
+	SV_EmitNailUpdate (sc, msg);
+	SV_EmitProjectileUpdate (sc, msg);
+}
+
+/*
+=============
+SV_ComparePriority
+=============
+*/
+static int SV_ComparePriority (const void *a, const void *b)
+{
+	const sv_candidate_t	*ca = a, *cb = b;
+
+	if (ca->priority != cb->priority)
+		return ca->priority > cb->priority ? -1 : 1;
+	return ca->num - cb->num;
+}
+
+/*
+=============
+SV_CompareNumber
+=============
+*/
+static int SV_CompareNumber (const void *a, const void *b)
+{
+	return ((const sv_candidate_t *)a)->num - ((const sv_candidate_t *)b)->num;
+}
+
+#define	PRIORITY_MAXAGE	5		// seconds unsent that still count for more
+#define	PRIORITY_KEEP	1.5		// how much more a newcomer must matter
+
+/*
+=============
+SV_PrioritizeEntities
+
+More entities are visible than fit in a packet.  Keeps the
+budget that matter most to the viewer: near ones, ones in
+front of it, and ones it hasn't been sent for a while, so that what is
+left out one frame comes in over the next ones.  Ones that were in the
+last packet count as owed the most and then PRIORITY_KEEP times that,
+so they only make way for one that matters that much more, rather than
+popping in and out as the ages even out.  The survivors are left in
+entity order.
+=============
+*/
+static void SV_PrioritizeEntities (sv_scratch_t *sc, client_t *client, edict_t *viewer, int budget)
+{
+	int		i;
+	sv_candidate_t	*c;
+	vec3_t	org, dir, forward, right, up;
+	float	dist, dot, age;
+
+	VectorAdd (viewer->v.origin, viewer->v.view_ofs, org);
+	AngleVectors (viewer->v.v_angle, forward, right, up);
+
+	for (i=0, c=sc->candidates ; i<sc->numcandidates ; i++, c++)
+	{
+		VectorSubtract (sv_entframe.center[c->num], org, dir);
+		dist = VectorNormalize (dir);
+		dot = DotProduct (dir, forward);
+		if (dot < 0)
+			dot = 0;
+		if (client->lastentsent && client->entsent[c->num] == client->lastentsent)
+			age = (PRIORITY_MAXAGE + 0.05) * PRIORITY_KEEP;	// in the last packet
+		else
+		{
+			age = realtime - client->entsent[c->num];
+			if (age > PRIORITY_MAXAGE)
+				age = PRIORITY_MAXAGE;
+			age += 0.05;
+		}
+
+		c->priority = age * (1 + 2*dot) / (dist + 256);
+	}
+
+	qsort (sc->candidates, sc->numcandidates, sizeof(*c), SV_ComparePriority);
+	sc->numcandidates = budget;
+	qsort (sc->candidates, sc->numcandidates, sizeof(*c), SV_CompareNumber);
+}
+
+/*
+=============
+SV_MarkEntitiesSent
+=============
+*/
+static void SV_MarkEntitiesSent (client_t *client, packet_entities_t *pack)
+{
+	int		i;
+
+	for (i=0 ; i<pack->num_entities ; i++)
+		client->entsent[pack->entities[i].number] = realtime;
+	client->lastentsent = realtime;
+}
+
+/*
+=============
+SV_GatherEntities
+
+Collects the non player entities visible in pvs into pack, and the
+nails into the scratch.  If there are too many for the packet, the ones
+client most needs from viewer's point of view are kept.
+=============
+*/
+void SV_GatherEntities (byte *pvs, packet_entities_t *pack, sv_scratch_t *sc, client_t *client, edict_t *viewer)
+{
+	int		e, i, budget;
+
+	sc->numcandidates = 0;
+	sc->numnails = 0;
+	sc->numprojectiles = 0;
 
-	numnails = 0;
+	// only the entities linked into a leaf of the pvs need looking at,
+	// walked in entity order because the packet delta depends on it
+	SV_VisibleEntities (pvs, sc->visents);
 
-	for (e=MAX_CLIENTS+1, ent=EDICT_NUM(e) ; e<sv.num_edicts ; e++, ent = NEXT_EDICT(ent))
+	for (e=MAX_CLIENTS+1 ; e<sv_entframe.numents ; e++)
 	{
+		if (!sc->visents[e>>3])
+		{
+			e |= 7;
+			continue;		// none of these eight
+		}
+		if (!(sc->visents[e>>3] & (1<<(e&7))))
+			continue;		// not visible
+
 		// ignore ents without visible models
-		if (!ent->v.modelindex || !*PR_GetString(ent->v.model))
+		if (!(sv_entframe.flags[e] & SVENT_VISIBLE))
 			continue;
 
-		// ignore if not touching a PV leaf
-		for (i=0 ; i < ent->num_leafs ; i++)
-			if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i]&7) ))
-				break;
-			
-		if (i == ent->num_leafs)
-			continue;		// not visible
+		if (client->projectiles && SV_AddProjectile (sc, e))
+			continue;	// added to the projectile list
 
-		if (SV_AddNailUpdate (ent))
+		if (SV_AddNailUpdate (sc, e))
 			continue;	// added to the special update list
 
-		// add to the packetentities
-		if (pack->num_entities == MAX_PACKET_ENTITIES)
-			continue;	// all full
+		sc->candidates[sc->numcandidates++].num = e;
+	}
 
-		state = &pack->entities[pack->num_entities];
-		pack->num_entities++;
+	// sv_adaptiverate may want fewer in a low rate client's updates
+	budget = MAX_PACKET_ENTITIES;
+	if (sv_adaptiverate.value && client->entbudget > 0 && client->entbudget < budget)
+		budget = client->entbudget;
 
-		state->number = e;
-		state->flags = 0;
-		VectorCopy (ent->v.origin, state->origin);
-		VectorCopy (ent->v.angles, state->angles);
-		state->modelindex = ent->v.modelindex;
-		state->frame = ent->v.frame;
-		state->colormap = ent->v.colormap;
-		state->skinnum = ent->v.skin;
-		state->effects = ent->v.effects;
+	if (sc->numcandidates > budget)
+		SV_PrioritizeEntities (sc, client, viewer, budget);
+
+	// add to the packetentities
+	pack->num_entities = sc->numcandidates;
+	for (i=0 ; i<sc->numcandidates ; i++)
+		pack->entities[i] = sv_entframe.state[sc->candidates[i].num];
+
+	SV_MarkEntitiesSent (client, pack);
+}
+
+/*
+=============
+SV_WriteEntitiesToSpectators
+
+Spectators that look through the same player's eyes, or fly around in the
+same leaf, are written together.  Their entities are gathered once, from
+the tracked player's view or the union of the free flyers' PVS, and the
+packetentities encoding is shared between those that delta from the
+same entities.
+=============
+*/
+void SV_WriteEntitiesToSpectators (client_t **clients, sizebuf_t **msgs, int count, sv_scratch_t *sc)
+{
+	int		i;
+	byte	*pvs;
+	vec3_t	org;
+	edict_t	*clent, *viewer;
+	client_t	*client;
+	packet_entities_t	*pack, *shared;
+
+	client = clients[0];
+	if (client->spec_track > 0)
+	{
+		viewer = svs.clients[client->spec_track - 1].edict;
+		VectorAdd (viewer->v.origin, viewer->v.view_ofs, org);
+		pvs = SV_FatPVS (sc, org);
+	}
+	else
+	{
+		viewer = client->edict;
+		VectorAdd (viewer->v.origin, viewer->v.view_ofs, org);
+		pvs = SV_FatPVS (sc, org);
+		for (i=1 ; i<count ; i++)
+		{
+			clent = clients[i]->edict;
+			VectorAdd (clent->v.origin, clent->v.view_ofs, org);
+			SV_AddToFatPVS (sc, org, sv.worldmodel->nodes);
+		}
 	}
 
-	// encode the packet entities as a delta from the
-	// last packetentities acknowledged by the client
+	sc->numdeltas = 0;
+	sc->nextdelta = 0;
+	shared = NULL;
+	for (i=0 ; i<count ; i++)
+	{
+		client = clients[i];
+		SV_WritePlayersToClient (client, client->edict, pvs, msgs[i]);
 
-	SV_EmitPacketEntities (client, pack, msg);
+		pack = &client->frames[client->netchan.incoming_sequence & UPDATE_MASK].entities;
+		if (!shared)
+		{
+			SV_GatherEntities (pvs, pack, sc, client, viewer);
+			shared = pack;
+		}
+		else
+		{
+			pack->num_entities = shared->num_entities;
+			memcpy (pack->entities, shared->entities, shared->num_entities*sizeof(entity_state_t));
+			SV_MarkEntitiesSent (client, pack);
+		}
 
-	// now add the specialized nail update
-	SV_EmitNailUpdate (msg);
+		SV_EmitSharedPacketEntities (client, pack, msgs[i], sc);
+		SV_EmitNailUpdate (sc, msgs[i]);
+		SV_EmitProjectileUpdate (sc, msgs[i]);
+	}
 }
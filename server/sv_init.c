@@ -52,21 +52,40 @@ int SV_ModelIndex (char *name)
 ================
 SV_FlushSignon
 
-Moves to the next signon buffer if needed
+Called between signon messages.  Ends the current chunk at the last
+message boundary if the message just written would overfill it.
 ================
 */
 void SV_FlushSignon (void)
 {
-	if (sv.signon.cursize < sv.signon.maxsize - 512)
-		return;
+	int		start;
 
-	if (sv.num_signon_buffers == MAX_SIGNON_BUFFERS-1)
-		SV_Error ("sv.num_signon_buffers == MAX_SIGNON_BUFFERS-1");
+	start = sv.signon_chunk[sv.num_signon_buffers-1];
+	if (sv.signon.cursize - start > SIGNON_CHUNK)
+	{
+		if (sv.signon_mark == start || sv.signon.cursize - sv.signon_mark > SIGNON_CHUNK)
+			SV_Error ("SV_FlushSignon: signon message over %i bytes", SIGNON_CHUNK);
+		if (sv.num_signon_buffers == MAX_SIGNON_CHUNKS)
+			SV_Error ("SV_FlushSignon: MAX_SIGNON_CHUNKS");
+		sv.signon_chunk[sv.num_signon_buffers] = sv.signon_mark;
+		sv.num_signon_buffers++;
+	}
+	sv.signon_mark = sv.signon.cursize;
+}
+
+/*
+================
+SV_FinishSignon
 
-	sv.signon_buffer_size[sv.num_signon_buffers-1] = sv.signon.cursize;
-	sv.signon.data = sv.signon_buffers[sv.num_signon_buffers];
-	sv.num_signon_buffers++;
-	sv.signon.cursize = 0;
+Closes the last signon chunk once the level is spawned
+================
+*/
+static void SV_FinishSignon (void)
+{
+	SV_FlushSignon ();
+	sv.signon_chunk[sv.num_signon_buffers] = sv.signon.cursize;
+	Con_DPrintf ("%i bytes of signon in %i chunks\n", sv.signon.cursize,
+		sv.num_signon_buffers);
 }
 
 /*
@@ -173,54 +192,77 @@ void SV_SaveSpawnparms (void)
 	}
 }
 
+/*
+=============================================================================
+
+The expanded PVS and the PHS take leafs squared bits each, which makes
+building them slow on big maps.  The PHS rows are or-ed in parallel, and
+both are saved to maps/<name>.phs in the game directory so the next load
+of the same bsp can read them back instead.
+
+=============================================================================
+*/
+
+cvar_t	sv_phscache = {"sv_phscache", "1"};	// keep built PHSs on disk
+
+#define	PHS_IDENT		(('S'<<24)+('H'<<16)+('P'<<8)+'Q')
+#define	PHS_VERSION		1
+#define	PHS_JOBROWS		64
+
+typedef struct
+{
+	int		ident;
+	int		version;
+	int		checksum;		// of the bsp it was built from
+	int		numleafs;
+	int		vcount, count;	// visible and hearable leafs, for the message
+} phsheader_t;
+
+static int		phs_rowwords;
+static int		phs_vcount[SYS_MAXTHREADS], phs_count[SYS_MAXTHREADS];
+static byte		phs_bitcount[256];
+
 /*
 ================
-SV_CalcPHS
+SV_CountLeafBits
 
-Expands the PVS and calculates the PHS
-(Potentially Hearable Set)
+Set bits in a row, not counting any past the last leaf
 ================
 */
-void SV_CalcPHS (void)
+static int SV_CountLeafBits (byte *row, int num)
+{
+	int		j, c;
+
+	c = 0;
+	for (j=0 ; j<num>>3 ; j++)
+		c += phs_bitcount[row[j]];
+	if (num & 7)
+		c += phs_bitcount[row[j] & ((1<<(num&7))-1)];
+	return c;
+}
+
+/*
+================
+SV_CalcPHSRows
+
+Sys_RunParallel job for PHS_JOBROWS rows of the PHS
+================
+*/
+static void SV_CalcPHSRows (int worker, int job)
 {
-	int		rowbytes, rowwords;
 	int		i, j, k, l, index, num;
-	int		bitbyte;
+	int		bitbyte, rowwords, rowbytes;
 	unsigned	*dest, *src;
 	byte	*scan;
-	int		count, vcount;
-
-	Con_Printf ("Building PHS...\n");
 
 	num = sv.worldmodel->numleafs;
-	rowwords = (num+31)>>5;
+	rowwords = phs_rowwords;
 	rowbytes = rowwords*4;
 
-	sv.pvs = Hunk_Alloc (rowbytes*num);
-	scan = sv.pvs;
-	vcount = 0;
-	for (i=0 ; i<num ; i++, scan+=rowbytes)
-	{
-		memcpy (scan, Mod_LeafPVS(sv.worldmodel->leafs+i, sv.worldmodel),
-			rowbytes);
-		if (i == 0)
-			continue;
-		for (j=0 ; j<num ; j++)
-		{
-			if ( scan[j>>3] & (1<<(j&7)) )
-			{
-				vcount++;
-			}
-		}
-	}
-
-
-	sv.phs = Hunk_Alloc (rowbytes*num);
-	count = 0;
-	scan = sv.pvs;
-	dest = (unsigned *)sv.phs;
-	for (i=0 ; i<num ; i++, dest += rowwords, scan += rowbytes)
+	for (i=job*PHS_JOBROWS ; i<num && i<(job+1)*PHS_JOBROWS ; i++)
 	{
+		scan = sv.pvs + i*rowbytes;
+		dest = (unsigned *)sv.phs + i*rowwords;
 		memcpy (dest, scan, rowbytes);
 		for (j=0 ; j<rowbytes ; j++)
 		{
@@ -237,20 +279,158 @@ void SV_CalcPHS (void)
 				if (index >= num)
 					continue;
 				src = (unsigned *)sv.pvs + index*rowwords;
-				for (l=0 ; l<rowwords ; l++)
+				for (l=0 ; l+4<=rowwords ; l+=4)
+				{
+					dest[l] |= src[l];
+					dest[l+1] |= src[l+1];
+					dest[l+2] |= src[l+2];
+					dest[l+3] |= src[l+3];
+				}
+				for ( ; l<rowwords ; l++)
 					dest[l] |= src[l];
 			}
 		}
 
 		if (i == 0)
 			continue;
-		for (j=0 ; j<num ; j++)
-			if ( ((byte *)dest)[j>>3] & (1<<(j&7)) )
-				count++;
+		phs_vcount[worker] += SV_CountLeafBits (scan, num);
+		phs_count[worker] += SV_CountLeafBits ((byte *)dest, num);
+	}
+}
+
+/*
+================
+SV_LoadPHS
+
+Reads sv.pvs and sv.phs back from the cache file if it matches the map
+================
+*/
+static qboolean SV_LoadPHS (char *name, int size, int *vcount, int *count)
+{
+	FILE	*f;
+	phsheader_t	header;
+	qboolean	ok;
+	int		mark;
+
+	f = fopen (name, "rb");
+	if (!f)
+		return false;
+
+	ok = false;
+	if (fread (&header, sizeof(header), 1, f) == 1
+	&& LittleLong (header.ident) == PHS_IDENT
+	&& LittleLong (header.version) == PHS_VERSION
+	&& LittleLong (header.checksum) == (int)sv.worldmodel->checksum
+	&& LittleLong (header.numleafs) == sv.worldmodel->numleafs)
+	{
+		mark = Hunk_LowMark ();
+		sv.pvs = Hunk_Alloc (size);
+		sv.phs = Hunk_Alloc (size);
+		ok = fread (sv.pvs, 1, size, f) == size && fread (sv.phs, 1, size, f) == size;
+		if (!ok)
+			Hunk_FreeToLowMark (mark);	// SV_CalcPHS allocates them again
+		*vcount = LittleLong (header.vcount);
+		*count = LittleLong (header.count);
+	}
+	fclose (f);
+	return ok;
+}
+
+/*
+================
+SV_SavePHS
+================
+*/
+static void SV_SavePHS (char *name, int size, int vcount, int count)
+{
+	FILE	*f;
+	phsheader_t	header;
+
+	COM_CreatePath (name);
+	f = fopen (name, "wb");
+	if (!f)
+	{
+		Con_Printf ("Couldn't write %s\n", name);
+		return;
+	}
+
+	header.ident = LittleLong (PHS_IDENT);
+	header.version = LittleLong (PHS_VERSION);
+	header.checksum = LittleLong (sv.worldmodel->checksum);
+	header.numleafs = LittleLong (sv.worldmodel->numleafs);
+	header.vcount = LittleLong (vcount);
+	header.count = LittleLong (count);
+	fwrite (&header, sizeof(header), 1, f);
+	fwrite (sv.pvs, 1, size, f);
+	fwrite (sv.phs, 1, size, f);
+	fclose (f);
+}
+
+/*
+================
+SV_CalcPHS
+
+Expands the PVS and calculates the PHS
+(Potentially Hearable Set)
+================
+*/
+void SV_CalcPHS (void)
+{
+	int		rowbytes;
+	int		i, num, size;
+	byte	*scan;
+	int		count, vcount;
+	char	name[MAX_OSPATH];
+	qboolean	cache;
+
+	num = sv.worldmodel->numleafs;
+	phs_rowwords = (num+31)>>5;
+	rowbytes = phs_rowwords*4;
+	size = rowbytes*num;
+
+	// no cache for a path that doesn't fit
+	cache = sv_phscache.value != 0;
+	i = snprintf (name, sizeof(name), "%s/maps/%s.phs", com_gamedir, sv.name);
+	if (i < 0 || i >= (int)sizeof(name))
+		cache = false;
+
+	if (cache && SV_LoadPHS (name, size, &vcount, &count))
+	{
+		Con_Printf ("Loaded PHS from %s\n", name);
+		Con_Printf ("Average leafs visible / hearable / total: %i / %i / %i\n"
+			, vcount/num, count/num, num);
+		return;
+	}
+
+	Con_Printf ("Building PHS...\n");
+
+	if (!phs_bitcount[255])
+		for (i=1 ; i<256 ; i++)
+			phs_bitcount[i] = (i&1) + phs_bitcount[i>>1];
+
+	sv.pvs = Hunk_Alloc (size);
+	scan = sv.pvs;
+	for (i=0 ; i<num ; i++, scan+=rowbytes)
+		memcpy (scan, Mod_LeafPVS(sv.worldmodel->leafs+i, sv.worldmodel),
+			rowbytes);
+
+	sv.phs = Hunk_Alloc (size);
+	memset (phs_vcount, 0, sizeof(phs_vcount));
+	memset (phs_count, 0, sizeof(phs_count));
+	Sys_RunParallel (SV_CalcPHSRows, (num+PHS_JOBROWS-1)/PHS_JOBROWS);
+
+	vcount = count = 0;
+	for (i=0 ; i<SYS_MAXTHREADS ; i++)
+	{
+		vcount += phs_vcount[i];
+		count += phs_count[i];
 	}
 
 	Con_Printf ("Average leafs visible / hearable / total: %i / %i / %i\n"
 		, vcount/num, count/num, num);
+
+	if (cache)
+		SV_SavePHS (name, size, vcount, count);
 }
 
 unsigned SV_CheckModel(char *mdl)
@@ -311,10 +491,13 @@ void SV_SpawnServer (char *server)
 	sv.master.maxsize = sizeof(sv.master_buf);
 	sv.master.data = sv.master_buf;
 	
-	sv.signon.maxsize = sizeof(sv.signon_buffers[0]);
-	sv.signon.data = sv.signon_buffers[0];
+	sv.signon.maxsize = sizeof(sv.signon_buf);
+	sv.signon.data = sv.signon_buf;
 	sv.num_signon_buffers = 1;
 
+	sv.lists.maxsize = sizeof(sv.lists_buf);
+	sv.lists.data = sv.lists_buf;
+
 	strcpy (sv.name, server);
 
 	// load progs to get entity field count
@@ -403,7 +586,10 @@ void SV_SpawnServer (char *server)
 
 	// create a baseline for more efficient communications
 	SV_CreateBaseline ();
-	sv.signon_buffer_size[sv.num_signon_buffers-1] = sv.signon.cursize;
+	SV_FinishSignon ();
+
+	// the precache lists can't change any more
+	SV_BuildLists ();
 
 	Info_SetValueForKey (svs.info, "map", sv.name, MAX_SERVERINFO_STRING);
 	Con_DPrintf ("Server spawned.\n");
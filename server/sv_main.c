@@ -56,6 +56,13 @@ cvar_t sv_highchars = {"sv_highchars", "1"};
 
 cvar_t sv_phs = {"sv_phs", "1"};
 
+cvar_t sv_specshare = {"sv_specshare", "0"};	// build spectator updates in groups
+
+cvar_t sv_adaptiverate = {"sv_adaptiverate", "0"};	// pace updates to each client's line
+
+cvar_t	sv_oobrate = {"sv_oobrate", "10"};		// connectionless packets a second from one address
+cvar_t	sv_oobmaxrate = {"sv_oobmaxrate", "500"};	// and from all of them, joins counted apart
+
 cvar_t pausable	= {"pausable", "1"};
 
 
@@ -218,6 +225,8 @@ void SV_DropClient (client_t *drop)
 	}
 	*drop->uploadfn = 0;
 
+	// zombies stay in the address hash until they are freed, so the
+	// disconnect can still be resent if it gets lost
 	drop->state = cs_zombie;		// become free in a few seconds
 	drop->connection_started = realtime;	// for zombie timeout
 
@@ -231,6 +240,106 @@ void SV_DropClient (client_t *drop)
 }
 
 
+/*
+=====================
+SV_AdrHash
+
+Hash of the ip, without the port
+=====================
+*/
+unsigned SV_AdrHash (netadr_t adr)
+{
+	unsigned	h;
+
+	h = adr.ip[0] | (adr.ip[1]<<8) | (adr.ip[2]<<16) | (adr.ip[3]<<24);
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+
+	return h;
+}
+
+/*
+=====================
+SV_ClientHashKey
+=====================
+*/
+int SV_ClientHashKey (netadr_t adr, int qport)
+{
+	unsigned	h;
+
+	// the port is left out on purpose, address translating
+	// routers are allowed to change it under us
+	h = SV_AdrHash (adr) ^ (qport & 0xffff);
+	h ^= h >> 8;
+
+	return h & (CLIENT_HASH_SIZE-1);
+}
+
+/*
+=====================
+SV_LinkClientAddress
+
+Makes the client reachable by SV_ClientForAddress.  New connections go in
+front of any zombie still holding the same address and qport.
+=====================
+*/
+void SV_LinkClientAddress (client_t *cl)
+{
+	int		key;
+
+	key = SV_ClientHashKey (cl->netchan.remote_address, cl->netchan.qport);
+	cl->hashnext = svs.clienthash[key];
+	svs.clienthash[key] = cl;
+}
+
+/*
+=====================
+SV_UnlinkClientAddress
+=====================
+*/
+void SV_UnlinkClientAddress (client_t *cl)
+{
+	client_t	**link;
+
+	link = &svs.clienthash[SV_ClientHashKey (cl->netchan.remote_address, cl->netchan.qport)];
+	for ( ; *link ; link = &(*link)->hashnext)
+	{
+		if (*link == cl)
+		{
+			*link = cl->hashnext;
+			break;
+		}
+	}
+	cl->hashnext = NULL;
+}
+
+/*
+=====================
+SV_ClientForAddress
+
+Returns the client a sequenced packet from adr with the given qport
+belongs to, or NULL
+=====================
+*/
+client_t *SV_ClientForAddress (netadr_t adr, int qport)
+{
+	client_t	*cl;
+
+	for (cl = svs.clienthash[SV_ClientHashKey (adr, qport)] ; cl ; cl = cl->hashnext)
+	{
+		if (cl->state == cs_free)
+			continue;
+		if (cl->netchan.qport != qport)
+			continue;
+		if (!NET_CompareBaseAdr (adr, cl->netchan.remote_address))
+			continue;
+		return cl;
+	}
+
+	return NULL;
+}
+
 //====================================================================
 
 /*
@@ -446,6 +555,88 @@ void SVC_Ping (void)
 	NET_SendPacket (1, &data, net_from);
 }
 
+/*
+=================
+SV_UnlinkChallenge
+=================
+*/
+void SV_UnlinkChallenge (challenge_t *ch)
+{
+	int		*link;
+	int		num;
+
+	num = ch - svs.challenges + 1;
+	link = &svs.challengehash[SV_AdrHash (ch->adr) & (CHALLENGE_HASH_SIZE-1)];
+	for ( ; *link ; link = &svs.challenges[*link - 1].hashnext)
+	{
+		if (*link == num)
+		{
+			*link = ch->hashnext;
+			break;
+		}
+	}
+	ch->hashnext = 0;
+}
+
+/*
+=================
+SV_FindChallenge
+
+Returns the live challenge for the ip of adr, or NULL.  Expired ones
+are dropped from the hash as they are found.
+=================
+*/
+challenge_t *SV_FindChallenge (netadr_t adr)
+{
+	int		num;
+	challenge_t	*ch;
+
+	num = svs.challengehash[SV_AdrHash (adr) & (CHALLENGE_HASH_SIZE-1)];
+	while (num)
+	{
+		ch = &svs.challenges[num - 1];
+		num = ch->hashnext;
+		if (!NET_CompareBaseAdr (adr, ch->adr))
+			continue;
+		if (realtime - ch->time > CHALLENGE_TIME)
+		{
+			SV_UnlinkChallenge (ch);
+			return NULL;
+		}
+		return ch;
+	}
+
+	return NULL;
+}
+
+/*
+=================
+SV_NewChallenge
+
+Challenges are handed out round robin, so the one replaced
+is always the oldest
+=================
+*/
+challenge_t *SV_NewChallenge (netadr_t adr)
+{
+	challenge_t	*ch;
+	int		key;
+
+	ch = &svs.challenges[svs.nextchallenge];
+	svs.nextchallenge = (svs.nextchallenge + 1) % MAX_CHALLENGES;
+	SV_UnlinkChallenge (ch);
+
+	ch->challenge = (rand() << 16) ^ rand();
+	ch->adr = adr;
+	ch->time = realtime;
+
+	key = SV_AdrHash (adr) & (CHALLENGE_HASH_SIZE-1);
+	ch->hashnext = svs.challengehash[key];
+	svs.challengehash[key] = ch - svs.challenges + 1;
+
+	return ch;
+}
+
 /*
 =================
 SVC_GetChallenge
@@ -459,37 +650,15 @@ challenge, they must give a valid IP address.
 */
 void SVC_GetChallenge (void)
 {
-	int		i;
-	int		oldest;
-	int		oldestTime;
-
-	oldest = 0;
-	oldestTime = 0x7fffffff;
+	challenge_t	*ch;
 
 	// see if we already have a challenge for this ip
-	for (i = 0 ; i < MAX_CHALLENGES ; i++)
-	{
-		if (NET_CompareBaseAdr (net_from, svs.challenges[i].adr))
-			break;
-		if (svs.challenges[i].time < oldestTime)
-		{
-			oldestTime = svs.challenges[i].time;
-			oldest = i;
-		}
-	}
-
-	if (i == MAX_CHALLENGES)
-	{
-		// overwrite the oldest
-		svs.challenges[oldest].challenge = (rand() << 16) ^ rand();
-		svs.challenges[oldest].adr = net_from;
-		svs.challenges[oldest].time = realtime;
-		i = oldest;
-	}
+	ch = SV_FindChallenge (net_from);
+	if (!ch)
+		ch = SV_NewChallenge (net_from);
 
 	// send it back
-	Netchan_OutOfBandPrint (net_from, "%c%i", S2C_CHALLENGE, 
-			svs.challenges[i].challenge);
+	Netchan_OutOfBandPrint (net_from, "%c%i", S2C_CHALLENGE, ch->challenge);
 }
 
 /*
@@ -515,6 +684,7 @@ void SVC_DirectConnect (void)
 	int			qport;
 	int			version;
 	int			challenge;
+	challenge_t	*ch;
 
 	version = atoi(Cmd_Argv(1));
 	if (version != PROTOCOL_VERSION)
@@ -533,19 +703,15 @@ void SVC_DirectConnect (void)
 	userinfo[sizeof(userinfo) - 2] = 0;
 
 	// see if the challenge is valid
-	for (i=0 ; i<MAX_CHALLENGES ; i++)
+	ch = SV_FindChallenge (net_from);
+	if (!ch)
 	{
-		if (NET_CompareBaseAdr (net_from, svs.challenges[i].adr))
-		{
-			if (challenge == svs.challenges[i].challenge)
-				break;		// good
-			Netchan_OutOfBandPrint (net_from, "%c\nBad challenge.\n", A2C_PRINT);
-			return;
-		}
+		Netchan_OutOfBandPrint (net_from, "%c\nNo challenge for address.\n", A2C_PRINT);
+		return;
 	}
-	if (i == MAX_CHALLENGES)
+	if (challenge != ch->challenge)
 	{
-		Netchan_OutOfBandPrint (net_from, "%c\nNo challenge for address.\n", A2C_PRINT);
+		Netchan_OutOfBandPrint (net_from, "%c\nBad challenge.\n", A2C_PRINT);
 		return;
 	}
 
@@ -677,6 +843,7 @@ void SVC_DirectConnect (void)
 	Netchan_Setup (&newcl->netchan , adr, qport);
 
 	newcl->state = cs_connected;
+	SV_LinkClientAddress (newcl);
 
 	newcl->datagram.allowoverflow = true;
 	newcl->datagram.data = newcl->datagram_buf;
@@ -766,6 +933,79 @@ void SVC_RemoteCommand (void)
 }
 
 
+/*
+=================
+SV_TakeToken
+
+Token bucket refilled at rate a second, holding up to two seconds worth
+=================
+*/
+qboolean SV_TakeToken (float *tokens, double *time, float rate)
+{
+	*tokens += (realtime - *time) * rate;
+	*time = realtime;
+	if (*tokens > 2*rate)
+		*tokens = 2*rate;
+	if (*tokens < 1)
+		return false;
+	*tokens -= 1;
+	return true;
+}
+
+/*
+=================
+SV_LimitConnectionless
+
+Returns true if the connectionless packet in net_message is over the rate
+allowed for its source or for all sources together.  Sources share a
+bucket when their addresses hash to the same slot, so flooding from
+spoofed addresses can't hand out fresh buckets.  getchallenge and connect
+have an overall bucket of their own, so a flood of other queries can't
+keep players from joining.
+=================
+*/
+#define	OOB_BUCKETS	1024		// power of two
+
+static float	oob_tokens[OOB_BUCKETS];
+static double	oob_time[OOB_BUCKETS];
+static float	oob_alltokens[2];
+static double	oob_alltime[2];
+
+qboolean SV_LimitConnectionless (qboolean join)
+{
+	int		b;
+
+	if (sv_oobrate.value > 0)
+	{
+		b = SV_AdrHash (net_from) & (OOB_BUCKETS-1);
+		if (!SV_TakeToken (&oob_tokens[b], &oob_time[b], sv_oobrate.value))
+			return true;
+	}
+
+	if (sv_oobmaxrate.value > 0)
+	{
+		if (!SV_TakeToken (&oob_alltokens[join], &oob_alltime[join], sv_oobmaxrate.value))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+=================
+SV_IsCommand
+
+True if the first word of s is cmd
+=================
+*/
+qboolean SV_IsCommand (char *s, char *cmd)
+{
+	int		len;
+
+	len = strlen (cmd);
+	return !strncmp (s, cmd, len) && (unsigned char)s[len] <= ' ';
+}
+
 /*
 =================
 SV_ConnectionlessPacket
@@ -779,52 +1019,73 @@ connectionless packets.
 void SV_ConnectionlessPacket (void)
 {
 	char	*s;
-	char	*c;
+
+	svs.oob_packets++;
 
 	MSG_BeginReading ();
 	MSG_ReadLong ();		// skip the -1 marker
 
 	s = MSG_ReadStringLine ();
 
-	Cmd_TokenizeString (s);
+	// only the commands that take arguments need the line tokenized
+	while (*s && (unsigned char)*s <= ' ')
+		s++;
 
-	c = Cmd_Argv(0);
+	if (SV_LimitConnectionless (SV_IsCommand (s, "getchallenge")
+		|| SV_IsCommand (s, "connect")))
+	{
+		svs.oob_limited++;
+		return;
+	}
 
-	if (!strcmp(c, "ping") || ( c[0] == A2A_PING && (c[1] == 0 || c[1] == '\n')) )
+	if (SV_IsCommand (s, "ping") || ( s[0] == A2A_PING && (unsigned char)s[1] <= ' ') )
 	{
 		SVC_Ping ();
 		return;
 	}
-	if (c[0] == A2A_ACK && (c[1] == 0 || c[1] == '\n') )
+	if (s[0] == A2A_ACK && (unsigned char)s[1] <= ' ')
 	{
 		Con_Printf ("A2A_ACK from %s\n", NET_AdrToString (net_from));
 		return;
 	}
-	else if (!strcmp(c,"status"))
+	else if (SV_IsCommand (s, "status"))
 	{
 		SVC_Status ();
 		return;
 	}
-	else if (!strcmp(c,"log"))
+	else if (SV_IsCommand (s, "log"))
 	{
+		Cmd_TokenizeString (s);
 		SVC_Log ();
 		return;
 	}
-	else if (!strcmp(c,"connect"))
+	else if (SV_IsCommand (s, "connect"))
 	{
+		Cmd_TokenizeString (s);
 		SVC_DirectConnect ();
 		return;
 	}
-	else if (!strcmp(c,"getchallenge"))
+	else if (SV_IsCommand (s, "getchallenge"))
 	{
 		SVC_GetChallenge ();
 		return;
 	}
-	else if (!strcmp(c, "rcon"))
+	else if (SV_IsCommand (s, "profile"))
+	{
+		SVC_Profile ();
+		return;
+	}
+	else if (SV_IsCommand (s, "rcon"))
+	{
+		Cmd_TokenizeString (s);
 		SVC_RemoteCommand ();
+	}
 	else
+	{
+		svs.oob_bad++;
 		Con_Printf ("bad connectionless packet from %s:\n%s\n"
 		, NET_AdrToString (net_from), s);
+	}
 }
 
 /*
@@ -854,6 +1115,14 @@ If 1 (the default), then ip addresses matching the current list will be prohibit
 
 If 0, then only addresses matching the list will be allowed.  This lets you easily set up a private game, or a game that only allows players from your local network.
 
+Ranges can also be given as "addip 192.246.40.0/22".
+
+Filters whose mask is a prefix, which is all of the CIDR ones and the usual
+dotted ones, are kept in a path compressed binary trie, so a lookup walks
+at most 33 nodes however long the list is.  The rare dotted filter with a
+zero in the middle, like "10.0.0.1", can't be a prefix and is checked one
+by one.
+
 
 ==============================================================================
 */
@@ -861,17 +1130,262 @@ If 0, then only addresses matching the list will be allowed.  This lets you easi
 
 typedef struct
 {
-	unsigned	mask;
+	unsigned	mask;			// host order, 0xc0f62800 is 192.246.40.0
 	unsigned	compare;
+	int			bits;			// prefix length if given as a CIDR, else -1
 } ipfilter_t;
 
-#define	MAX_IPFILTERS	1024
+typedef struct
+{
+	unsigned	key;			// masked to bits
+	int			bits;
+	int			count;			// filters with exactly this prefix
+	int			child[2];		// -1 = none
+} iptnode_t;
 
-ipfilter_t	ipfilters[MAX_IPFILTERS];
+typedef struct
+{
+	iptnode_t	*nodes;
+	int			numnodes;
+	int			maxnodes;
+	int			freenode;		// free list through child[0], -1 = empty
+	int			root;			// -1 = empty
+} iptrie_t;
+
+ipfilter_t	*ipfilters;			// in the order they were added
 int			numipfilters;
+int			maxipfilters;
+
+iptrie_t	iptrie = {NULL, 0, 0, -1, -1};
+int			numirregularfilters;	// non prefix masks, only found in ipfilters
 
 cvar_t	filterban = {"filterban", "1"};
 
+#define	PREFIXMASK(bits)	((bits) ? 0xffffffff << (32 - (bits)) : 0)
+#define	KEYBIT(key,bit)		(((key) >> (31 - (bit))) & 1)
+
+/*
+=================
+IPT_Clear
+=================
+*/
+void IPT_Clear (iptrie_t *t)
+{
+	free (t->nodes);
+	t->nodes = NULL;
+	t->numnodes = t->maxnodes = 0;
+	t->freenode = -1;
+	t->root = -1;
+}
+
+/*
+=================
+IPT_Reserve
+
+Makes sure the next count IPT_AllocNode calls don't move the nodes
+=================
+*/
+void IPT_Reserve (iptrie_t *t, int count)
+{
+	int		i, avail;
+	iptnode_t	*n;
+
+	for (avail=0, i=t->freenode ; i>=0 && avail<count ; i=t->nodes[i].child[0])
+		avail++;
+	if (avail + t->maxnodes - t->numnodes >= count)
+		return;
+
+	t->maxnodes = t->maxnodes ? t->maxnodes*2 : 64;
+	n = realloc (t->nodes, t->maxnodes * sizeof(*n));
+	if (!n)
+		Sys_Error ("IPT_Reserve: out of memory for %i nodes", t->maxnodes);
+	t->nodes = n;
+}
+
+int IPT_AllocNode (iptrie_t *t, unsigned key, int bits, int count)
+{
+	int			i;
+	iptnode_t	*n;
+
+	if (t->freenode >= 0)
+	{
+		i = t->freenode;
+		t->freenode = t->nodes[i].child[0];
+	}
+	else
+		i = t->numnodes++;
+
+	n = &t->nodes[i];
+	n->key = key & PREFIXMASK(bits);
+	n->bits = bits;
+	n->count = count;
+	n->child[0] = n->child[1] = -1;
+	return i;
+}
+
+void IPT_FreeNode (iptrie_t *t, int i)
+{
+	t->nodes[i].child[0] = t->freenode;
+	t->freenode = i;
+}
+
+/*
+=================
+IPT_Insert
+=================
+*/
+void IPT_Insert (iptrie_t *t, unsigned key, int bits)
+{
+	int			*link;
+	int			n, new, branch;
+	int			common, max;
+	iptnode_t	*node;
+	unsigned	diff;
+
+	IPT_Reserve (t, 2);
+	key &= PREFIXMASK(bits);
+
+	link = &t->root;
+	while (1)
+	{
+		n = *link;
+		if (n < 0)
+		{
+			*link = IPT_AllocNode (t, key, bits, 1);
+			return;
+		}
+		node = &t->nodes[n];
+
+		// count the leading bits the two prefixes share
+		max = bits < node->bits ? bits : node->bits;
+		diff = key ^ node->key;
+		for (common=0 ; common<max && !KEYBIT(diff, common) ; common++)
+			;
+
+		if (common == node->bits)
+		{
+			if (common == bits)
+			{	// the same prefix again
+				node->count++;
+				return;
+			}
+			link = &node->child[KEYBIT(key, node->bits)];
+			continue;
+		}
+
+		if (common == bits)
+		{	// the new prefix covers this node
+			new = IPT_AllocNode (t, key, bits, 1);
+			t->nodes[new].child[KEYBIT(t->nodes[n].key, bits)] = n;
+			*link = new;
+			return;
+		}
+
+		// they part ways at common
+		branch = IPT_AllocNode (t, key, common, 0);
+		new = IPT_AllocNode (t, key, bits, 1);
+		t->nodes[branch].child[KEYBIT(key, common)] = new;
+		t->nodes[branch].child[!KEYBIT(key, common)] = n;
+		*link = branch;
+		return;
+	}
+}
+
+/*
+=================
+IPT_Remove
+
+Removes one filter of exactly key/bits, returns false if there wasn't one
+=================
+*/
+qboolean IPT_Remove (iptrie_t *t, unsigned key, int bits)
+{
+	int			*links[34];
+	int			depth;
+	int			n;
+	iptnode_t	*node;
+
+	key &= PREFIXMASK(bits);
+
+	depth = 0;
+	links[0] = &t->root;
+	while (1)
+	{
+		n = *links[depth];
+		if (n < 0)
+			return false;
+		node = &t->nodes[n];
+		if (node->bits > bits || ((key ^ node->key) & PREFIXMASK(node->bits)))
+			return false;
+		if (node->bits == bits)
+			break;
+		links[depth+1] = &node->child[KEYBIT(key, node->bits)];
+		depth++;
+	}
+
+	if (!node->count)
+		return false;
+	if (--node->count)
+		return true;
+
+	// take out nodes that no longer hold a filter or split two ways
+	while (depth >= 0)
+	{
+		n = *links[depth];
+		node = &t->nodes[n];
+		if (node->count || (node->child[0] >= 0 && node->child[1] >= 0))
+			break;
+		*links[depth] = node->child[0] >= 0 ? node->child[0] : node->child[1];
+		IPT_FreeNode (t, n);
+		depth--;
+	}
+
+	return true;
+}
+
+/*
+=================
+IPT_Match
+=================
+*/
+qboolean IPT_Match (iptrie_t *t, unsigned ip)
+{
+	int			n;
+	iptnode_t	*node;
+
+	for (n = t->root ; n >= 0 ; )
+	{
+		node = &t->nodes[n];
+		if ((ip ^ node->key) & PREFIXMASK(node->bits))
+			return false;
+		if (node->count)
+			return true;
+		if (node->bits == 32)
+			return false;
+		n = node->child[KEYBIT(ip, node->bits)];
+	}
+
+	return false;
+}
+
+/*
+=================
+FilterPrefix
+
+Returns the prefix length of the filter's mask, or -1 if it has holes
+=================
+*/
+int FilterPrefix (ipfilter_t *f)
+{
+	int		bits;
+
+	for (bits=0 ; bits<32 && KEYBIT(f->mask, bits) ; bits++)
+		;
+	if (f->mask != PREFIXMASK(bits))
+		return -1;
+	return bits;
+}
+
 /*
 =================
 StringToFilter
@@ -879,46 +1393,79 @@ StringToFilter
 */
 qboolean StringToFilter (char *s, ipfilter_t *f)
 {
-	char	num[128];
-	int		i, j;
+	char	*start;
+	int		i, num;
 	byte	b[4];
 	byte	m[4];
 	
+	start = s;
 	for (i=0 ; i<4 ; i++)
 	{
 		b[i] = 0;
 		m[i] = 0;
 	}
+	f->bits = -1;
 	
 	for (i=0 ; i<4 ; i++)
 	{
 		if (*s < '0' || *s > '9')
 		{
-			Con_Printf ("Bad filter address: %s\n", s);
+			Con_Printf ("Bad filter address: %s\n", start);
 			return false;
 		}
 		
-		j = 0;
+		num = 0;
 		while (*s >= '0' && *s <= '9')
-		{
-			num[j++] = *s++;
-		}
-		num[j] = 0;
-		b[i] = atoi(num);
+			num = num*10 + *s++ - '0';
+		b[i] = num;
 		if (b[i] != 0)
 			m[i] = 255;
 
-		if (!*s)
+		if (*s != '.')
 			break;
 		s++;
 	}
-	
-	f->mask = *(unsigned *)m;
-	f->compare = *(unsigned *)b;
-	
+
+	f->compare = (b[0]<<24) | (b[1]<<16) | (b[2]<<8) | b[3];
+	f->mask = (m[0]<<24) | (m[1]<<16) | (m[2]<<8) | m[3];
+
+	if (*s == '/')
+	{
+		f->bits = atoi (s+1);
+		if (s[1] < '0' || s[1] > '9' || f->bits > 32)
+		{
+			Con_Printf ("Bad filter prefix: %s\n", start);
+			return false;
+		}
+		f->mask = PREFIXMASK(f->bits);
+	}
+	else if (*s)
+	{
+		Con_Printf ("Bad filter address: %s\n", start);
+		return false;
+	}
+
+	f->compare &= f->mask;
 	return true;
 }
 
+/*
+=================
+FilterToString
+=================
+*/
+char *FilterToString (ipfilter_t *f)
+{
+	static char	s[32];
+	unsigned	c;
+
+	c = f->compare;
+	sprintf (s, "%i.%i.%i.%i", c>>24, (c>>16)&255, (c>>8)&255, c&255);
+	if (f->bits >= 0)
+		sprintf (s+strlen(s), "/%i", f->bits);
+	return s;
+}
+
 /*
 =================
 SV_AddIP_f
@@ -926,23 +1473,31 @@ SV_AddIP_f
 */
 void SV_AddIP_f (void)
 {
-	int		i;
-	
-	for (i=0 ; i<numipfilters ; i++)
-		if (ipfilters[i].compare == 0xffffffff)
-			break;		// free spot
-	if (i == numipfilters)
+	ipfilter_t	f, *n;
+	int			bits;
+
+	if (!StringToFilter (Cmd_Argv(1), &f))
+		return;
+
+	if (numipfilters == maxipfilters)
 	{
-		if (numipfilters == MAX_IPFILTERS)
+		maxipfilters = maxipfilters ? maxipfilters*2 : 64;
+		n = realloc (ipfilters, maxipfilters * sizeof(*n));
+		if (!n)
 		{
 			Con_Printf ("IP filter list is full\n");
+			maxipfilters = numipfilters;
 			return;
 		}
-		numipfilters++;
+		ipfilters = n;
 	}
-	
-	if (!StringToFilter (Cmd_Argv(1), &ipfilters[i]))
-		ipfilters[i].compare = 0xffffffff;
+	ipfilters[numipfilters++] = f;
+
+	bits = FilterPrefix (&f);
+	if (bits >= 0)
+		IPT_Insert (&iptrie, f.compare, bits);
+	else
+		numirregularfilters++;
 }
 
 /*
@@ -953,7 +1508,7 @@ SV_RemoveIP_f
 void SV_RemoveIP_f (void)
 {
 	ipfilter_t	f;
-	int			i, j;
+	int			i, bits;
 
 	if (!StringToFilter (Cmd_Argv(1), &f))
 		return;
@@ -961,9 +1516,13 @@ void SV_RemoveIP_f (void)
 		if (ipfilters[i].mask == f.mask
 		&& ipfilters[i].compare == f.compare)
 		{
-			for (j=i+1 ; j<numipfilters ; j++)
-				ipfilters[j-1] = ipfilters[j];
+			bits = FilterPrefix (&ipfilters[i]);
+			if (bits >= 0)
+				IPT_Remove (&iptrie, f.compare, bits);
+			else
+				numirregularfilters--;
 			numipfilters--;
+			memmove (&ipfilters[i], &ipfilters[i+1], (numipfilters-i)*sizeof(*ipfilters));
 			Con_Printf ("Removed.\n");
 			return;
 		}
@@ -978,13 +1537,16 @@ SV_ListIP_f
 void SV_ListIP_f (void)
 {
 	int		i;
-	byte	b[4];
+	unsigned	c;
 
 	Con_Printf ("Filter list:\n");
 	for (i=0 ; i<numipfilters ; i++)
 	{
-		*(unsigned *)b = ipfilters[i].compare;
-		Con_Printf ("%3i.%3i.%3i.%3i\n", b[0], b[1], b[2], b[3]);
+		c = ipfilters[i].compare;
+		if (ipfilters[i].bits >= 0)
+			Con_Printf ("%s\n", FilterToString (&ipfilters[i]));
+		else
+			Con_Printf ("%3i.%3i.%3i.%3i\n", c>>24, (c>>16)&255, (c>>8)&255, c&255);
 	}
 }
 
@@ -997,7 +1559,6 @@ void SV_WriteIP_f (void)
 {
 	FILE	*f;
 	char	name[MAX_OSPATH];
-	byte	b[4];
 	int		i;
 
 	sprintf (name, "%s/listip.cfg", com_gamedir);
@@ -1012,10 +1573,7 @@ void SV_WriteIP_f (void)
 	}
 	
 	for (i=0 ; i<numipfilters ; i++)
-	{
-		*(unsigned *)b = ipfilters[i].compare;
-		fprintf (f, "addip %i.%i.%i.%i\n", b[0], b[1], b[2], b[3]);
-	}
+		fprintf (f, "addip %s\n", FilterToString (&ipfilters[i]));
 	
 	fclose (f);
 }
@@ -1047,15 +1605,88 @@ qboolean SV_FilterPacket (void)
 	int		i;
 	unsigned	in;
 	
-	in = *(unsigned *)net_from.ip;
+	in = (net_from.ip[0]<<24) | (net_from.ip[1]<<16) | (net_from.ip[2]<<8) | net_from.ip[3];
 
-	for (i=0 ; i<numipfilters ; i++)
-		if ( (in & ipfilters[i].mask) == ipfilters[i].compare)
-			return filterban.value;
+	if (IPT_Match (&iptrie, in))
+		return filterban.value;
+
+	if (numirregularfilters)
+		for (i=0 ; i<numipfilters ; i++)
+			if ( (in & ipfilters[i].mask) == ipfilters[i].compare)
+				return filterban.value;
 
 	return !filterban.value;
 }
 
+/*
+=================
+SV_IPBench_f
+
+Times filter lookups with the trie against the old linear scan
+=================
+*/
+void SV_IPBench_f (void)
+{
+	static int	sizes[] = {10, 1000, 100000};
+	iptrie_t	t = {NULL, 0, 0, -1, -1};
+	ipfilter_t	*list;
+	unsigned	*ips;
+	int			s, i, j, k, n, bits, hits, lookups;
+	double		start, trietime, lineartime;
+
+	lookups = 1000000;
+	ips = malloc (lookups * sizeof(*ips));
+	list = malloc (sizes[2] * sizeof(*list));
+	if (!ips || !list)
+	{
+		free (ips);
+		free (list);
+		Con_Printf ("ipbench: out of memory\n");
+		return;
+	}
+	for (i=0 ; i<lookups ; i++)
+		ips[i] = ((unsigned)rand() << 20) ^ ((unsigned)rand() << 8) ^ rand();
+
+	for (s=0 ; s<3 ; s++)
+	{
+		n = sizes[s];
+		IPT_Clear (&t);
+		for (i=0 ; i<n ; i++)
+		{
+			bits = 8 + rand() % 25;	// /8 to /32
+			list[i].mask = PREFIXMASK(bits);
+			list[i].compare = (((unsigned)rand() << 20) ^ ((unsigned)rand() << 8) ^ rand()) & list[i].mask;
+			IPT_Insert (&t, list[i].compare, bits);
+		}
+
+		hits = 0;
+		start = Sys_DoubleTime ();
+		for (i=0 ; i<lookups ; i++)
+			hits += IPT_Match (&t, ips[i]);
+		trietime = Sys_DoubleTime () - start;
+
+		// keep the linear scan to about 10^8 compares
+		j = 100000000 / n;
+		if (j > lookups)
+			j = lookups;
+		start = Sys_DoubleTime ();
+		for (i=0 ; i<j ; i++)
+		{
+			for (k=0 ; k<n ; k++)
+				if ( (ips[i] & list[k].mask) == list[k].compare)
+					break;
+		}
+		lineartime = (Sys_DoubleTime () - start) * lookups / j;
+
+		Con_Printf ("%6i filters: trie %6.1f ns, linear %9.1f ns a lookup (%i nodes, %i hits)\n",
+			n, trietime*1e9/lookups, lineartime*1e9/lookups, t.numnodes, hits);
+	}
+
+	IPT_Clear (&t);
+	free (ips);
+	free (list);
+}
+
 //============================================================================
 
 /*
@@ -1065,7 +1696,6 @@ SV_ReadPackets
 */
 void SV_ReadPackets (void)
 {
-	int			i;
 	client_t	*cl;
 	qboolean	good;
 	int			qport;
@@ -1094,16 +1724,13 @@ void SV_ReadPackets (void)
 		qport = MSG_ReadShort () & 0xffff;
 
 		// check for packets from connected clients
-		for (i=0, cl=svs.clients ; i<MAX_CLIENTS ; i++,cl++)
+		cl = SV_ClientForAddress (net_from, qport);
+		if (cl)
 		{
-			if (cl->state == cs_free)
-				continue;
-			if (!NET_CompareBaseAdr (net_from, cl->netchan.remote_address))
-				continue;
-			if (cl->netchan.qport != qport)
-				continue;
 			if (cl->netchan.remote_address.port != net_from.port)
 			{
+				// the port is not part of the hash key, so the
+				// client stays in the same chain
 				Con_DPrintf ("SV_ReadPackets: fixing up a translated port\n");
 				cl->netchan.remote_address.port = net_from.port;
 			}
@@ -1115,11 +1742,8 @@ void SV_ReadPackets (void)
 				if (cl->state != cs_zombie)
 					SV_ExecuteClientMessage (cl);
 			}
-			break;
-		}
-		
-		if (i != MAX_CLIENTS)
 			continue;
+		}
 	
 		// packet is not from a known client
 		//	Con_Printf ("%s:sequenced packet without connection\n"
@@ -1157,12 +1781,14 @@ void SV_CheckTimeouts (void)
 			if (cl->netchan.last_received < droptime) {
 				SV_BroadcastPrintf (PRINT_HIGH, "%s timed out\n", cl->name);
 				SV_DropClient (cl); 
+				SV_UnlinkClientAddress (cl);
 				cl->state = cs_free;	// don't bother with zombie state
 			}
 		}
 		if (cl->state == cs_zombie && 
 			realtime - cl->connection_started > zombietime.value)
 		{
+			SV_UnlinkClientAddress (cl);
 			cl->state = cs_free;	// can now be reused
 		}
 	}
@@ -1223,13 +1849,14 @@ void SV_CheckVars (void)
 
 /*
 ==================
-SV_Frame
+SV_RunFrame
 
 ==================
 */
-void SV_Frame (float time)
+static void SV_RunFrame (float time, qboolean physics)
 {
 	static double	start, end;
+	double		mark, now;
 	
 	start = Sys_DoubleTime ();
 	svs.stats.idle += start - end;
@@ -1250,11 +1877,27 @@ void SV_Frame (float time)
 	SV_CheckLog ();
 
 // move autonomous things around if enough time has passed
-	if (!sv.paused)
+	mark = start;
+	if (!sv.paused && physics)
+	{
 		SV_Physics ();
+		if (sv_profile.value)
+		{
+			now = Sys_DoubleTime ();
+			SV_ProfileSample (PROF_PHYSICS, now - mark);
+			mark = now;
+		}
+	}
 
-// get packets
+// get packets, and run any player moves they queued
 	SV_ReadPackets ();
+	SV_RunMoves ();
+	if (sv_profile.value)
+	{
+		now = Sys_DoubleTime ();
+		SV_ProfileSample (PROF_PACKETS, now - mark);
+		mark = now;
+	}
 
 // check for commands typed to the host
 	SV_GetConsoleCommands ();
@@ -1263,15 +1906,29 @@ void SV_Frame (float time)
 	Cbuf_Execute ();
 
 	SV_CheckVars ();
+	if (sv_profile.value)
+	{
+		now = Sys_DoubleTime ();
+		SV_ProfileSample (PROF_COMMANDS, now - mark);
+		mark = now;
+	}
 
-// send messages back to the clients that had packets read this frame
+// send messages back to the clients that had packets read this frame,
+// queued up so they all go out in one call
+	NET_BeginSendBatch ();
 	SV_SendClientMessages ();
 
 // send a heartbeat to the master if needed
 	Master_Heartbeat ();
+	NET_FlushSendBatch ();
 
 // collect timing statistics
 	end = Sys_DoubleTime ();
+	if (sv_profile.value)
+	{
+		SV_ProfileSample (PROF_SEND, end - mark);
+		SV_ProfileFrame (end - start);
+	}
 	svs.stats.active += end-start;
 	if (++svs.stats.count == STATFRAMES)
 	{
@@ -1285,6 +1942,62 @@ void SV_Frame (float time)
 	}
 }
 
+/*
+==================
+SV_Frame
+
+==================
+*/
+void SV_Frame (float time)
+{
+	SV_RunFrame (time, true);
+}
+
+/*
+==================
+SV_TicFrame
+
+Used by the fixed rate scheduler.  A tic of 0 only services the network,
+otherwise the physics is run for exactly tic seconds.
+==================
+*/
+void SV_TicFrame (float time, double tic)
+{
+	sv_fixedtic = tic;
+	SV_RunFrame (time, tic != 0);
+	sv_fixedtic = 0;
+}
+
+/*
+==================
+SV_TicStats
+
+late is how far the tic started from its deadline
+==================
+*/
+void SV_TicStats (double late, int skipped)
+{
+	svticstats_t	*ts;
+
+	ts = &svs.ticstats;
+	if (late < 0)
+		late = -late;
+	ts->jitter += late;
+	if (late > ts->maxjitter)
+		ts->maxjitter = late;
+	ts->skipped += skipped;
+	if (++ts->count == STATFRAMES)
+	{
+		ts->latched_jitter = ts->jitter;
+		ts->latched_maxjitter = ts->maxjitter;
+		ts->latched_skipped = ts->skipped;
+		ts->jitter = 0;
+		ts->maxjitter = 0;
+		ts->skipped = 0;
+		ts->count = 0;
+	}
+}
+
 /*
 ===============
 SV_InitLocal
@@ -1305,6 +2018,7 @@ void SV_InitLocal (void)
 	extern	cvar_t	sv_waterfriction;
 
 	SV_InitOperatorCommands	();
+	SV_ProfileInit ();
 	SV_UserInit ();
 	
 	Cvar_RegisterVariable (&rcon_password);
@@ -1354,6 +2068,12 @@ void SV_InitLocal (void)
 	Cvar_RegisterVariable (&sv_highchars);
 
 	Cvar_RegisterVariable (&sv_phs);
+	Cvar_RegisterVariable (&sv_phscache);
+	Cvar_RegisterVariable (&sv_specshare);
+	Cvar_RegisterVariable (&sv_adaptiverate);
+	Cvar_RegisterVariable (&sv_pvscache);
+	Cvar_RegisterVariable (&sv_oobrate);
+	Cvar_RegisterVariable (&sv_oobmaxrate);
 
 	Cvar_RegisterVariable (&pausable);
 
@@ -1361,6 +2081,9 @@ void SV_InitLocal (void)
 	Cmd_AddCommand ("removeip", SV_RemoveIP_f);
 	Cmd_AddCommand ("listip", SV_ListIP_f);
 	Cmd_AddCommand ("writeip", SV_WriteIP_f);
+	Cmd_AddCommand ("ipbench", SV_IPBench_f);
+	Cmd_AddCommand ("tracebench", SV_TraceBench_f);
+	Cmd_AddCommand ("areabench", SV_AreaBench_f);
 
 	for (i=0 ; i<MAX_MODELS ; i++)
 		sprintf (localmodels[i], "*%i", i);
@@ -1566,6 +2289,9 @@ void SV_ExtractFromUserinfo (client_t *cl)
 		cl->messagelevel = atoi(val);
 	}
 
+	// clients that understand svc_projectiles
+	cl->projectiles = atoi (Info_ValueForKey (cl->userinfo, "proj")) != 0;
+
 }
 
 
@@ -1590,6 +2316,10 @@ void SV_InitNet (void)
 	}
 	NET_Init (port);
 
+	// drain and answer packets with as few system calls as possible
+	if (!COM_CheckParm ("-nonetbatch"))
+		NET_EnableBatching (true);
+
 	Netchan_Init ();
 
 	// heartbeats will allways be sent to the id master
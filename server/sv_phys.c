@@ -884,6 +884,8 @@ void SV_RunNewmis (void)
 	SV_RunEntity (ent);		
 }
 
+double	sv_fixedtic;	// set while the system scheduler runs a tic of its own
+
 /*
 ================
 SV_Physics
@@ -896,12 +898,19 @@ void SV_Physics (void)
 	edict_t	*ent;
 	static double	old_time;
 
-// don't bother running a frame if sys_ticrate seconds haven't passed
-	host_frametime = realtime - old_time;
-	if (host_frametime < sv_mintic.value)
-		return;
-	if (host_frametime > sv_maxtic.value)
-		host_frametime = sv_maxtic.value;
+	if (sv_fixedtic)
+	{	// the scheduler has already decided a tic is due
+		host_frametime = sv_fixedtic;
+	}
+	else
+	{
+	// don't bother running a frame if sys_ticrate seconds haven't passed
+		host_frametime = realtime - old_time;
+		if (host_frametime < sv_mintic.value)
+			return;
+		if (host_frametime > sv_maxtic.value)
+			host_frametime = sv_maxtic.value;
+	}
 	old_time = realtime;
 
 	pr_global_struct->frametime = host_frametime;
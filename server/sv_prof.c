@@ -0,0 +1,252 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sv_prof.c -- frame phase timing
+
+#include "qwsvdef.h"
+
+/*
+=============================================================================
+
+Every frame the time spent in each phase is put in a histogram with four
+buckets per doubling of microseconds, so percentiles come out within a
+quarter however long or short the phase is.  The histograms run from
+server start or the last "profile reset".
+
+=============================================================================
+*/
+
+cvar_t	sv_profile = {"sv_profile", "1"};
+
+extern	cvar_t	sv_adaptiverate;
+
+double	sv_qctime;			// outermost PR_ExecuteProgram time this frame
+
+profhist_t	sv_prof[NUM_PROF];
+
+static char	*prof_names[NUM_PROF] =
+{
+	"frame",
+	"packets",
+	"physics",
+	"commands",
+	"send",
+	"qc"
+};
+
+/*
+================
+SV_ProfileBucket
+================
+*/
+static int SV_ProfileBucket (double seconds)
+{
+	double	m;
+	int		e, b;
+
+	if (seconds < 0.000001)
+		return 0;
+	m = frexp (seconds * 1000000, &e);	// m is 0.5 to 1
+	b = e*4 + (int)((m - 0.5) * 8);
+	if (b < 0)
+		b = 0;
+	if (b >= PROF_BUCKETS)
+		b = PROF_BUCKETS-1;
+	return b;
+}
+
+/*
+================
+SV_ProfileSample
+================
+*/
+void SV_ProfileSample (int phase, double seconds)
+{
+	profhist_t	*h;
+
+	h = &sv_prof[phase];
+	h->buckets[SV_ProfileBucket (seconds)]++;
+	h->count++;
+	h->total += seconds;
+	if (seconds > h->max)
+		h->max = seconds;
+}
+
+/*
+================
+SV_ProfilePercentile
+
+Upper edge of the bucket holding the given fraction of the samples
+================
+*/
+double SV_ProfilePercentile (profhist_t *h, double fraction)
+{
+	int		b, need, seen;
+
+	if (!h->count)
+		return 0;
+	need = (int)(h->count * fraction);
+	if (need < 1)
+		need = 1;
+	for (b=0, seen=0 ; b<PROF_BUCKETS-1 ; b++)
+	{
+		seen += h->buckets[b];
+		if (seen >= need)
+			break;
+	}
+	if (!b)
+		return 0.000001;
+	// bucket b starts at 2^(b/4) * (0.5 + (b&3)/8) microseconds
+	return ldexp (0.5 + ((b&3)+1)*0.125, b/4) * 0.000001;
+}
+
+/*
+================
+SV_ClientSendCost
+
+Adds time spent building and sending a client's packet
+================
+*/
+void SV_ClientSendCost (client_t *cl, double seconds)
+{
+	cl->sendtime += seconds;
+}
+
+/*
+================
+SV_ProfileFrame
+
+Called at the end of every SV_Frame
+================
+*/
+void SV_ProfileFrame (double frametime)
+{
+	int			i;
+	client_t	*cl;
+
+	SV_ProfileSample (PROF_FRAME, frametime);
+	SV_ProfileSample (PROF_QC, sv_qctime);
+	sv_qctime = 0;
+
+	// smooth the per client cost over the frames they were sent to
+	for (i=0, cl=svs.clients ; i<MAX_CLIENTS ; i++, cl++)
+	{
+		if (!cl->sendtime)
+			continue;
+		cl->sendcost = cl->sendcost*0.95 + cl->sendtime*0.05;
+		cl->sendtime = 0;
+	}
+}
+
+/*
+================
+SV_Profile_f
+================
+*/
+void SV_Profile_f (void)
+{
+	int			i;
+	profhist_t	*h;
+	client_t	*cl;
+
+	if (!strcmp (Cmd_Argv(1), "reset"))
+	{
+		memset (sv_prof, 0, sizeof(sv_prof));
+		memset (&sv_linkstats, 0, sizeof(sv_linkstats));
+		memset (&sv_movecheck, 0, sizeof(sv_movecheck));
+		Con_Printf ("Profile reset.\n");
+		return;
+	}
+
+	if (!sv_profile.value)
+		Con_Printf ("sv_profile is off\n");
+
+	Con_Printf ("phase      count   avg ms   p50 ms   p99 ms   max ms\n");
+	for (i=0, h=sv_prof ; i<NUM_PROF ; i++, h++)
+		Con_Printf ("%-8s %7i %8.3f %8.3f %8.3f %8.3f\n", prof_names[i], h->count,
+			h->count ? 1000*h->total/h->count : 0,
+			1000*SV_ProfilePercentile (h, 0.5),
+			1000*SV_ProfilePercentile (h, 0.99),
+			1000*h->max);
+
+	Con_Printf ("\n%i relinks, %i kept their leafs, %i kept their area cell\n",
+		sv_linkstats.links, sv_linkstats.leafskips, sv_linkstats.areaskips);
+
+	if (sv_movecheck.checked || sv_movecheck.touched)
+		Con_Printf ("%i parallel moves matched serial, %i differed, %i touched a player\n",
+			sv_movecheck.checked - sv_movecheck.differed, sv_movecheck.differed,
+			sv_movecheck.touched);
+
+	Con_Printf ("\nclient send cost\n");
+	for (i=0, cl=svs.clients ; i<MAX_CLIENTS ; i++, cl++)
+	{
+		if (cl->state < cs_connected)
+			continue;
+		Con_Printf ("%2i %-16s %6.3f ms", i, cl->name, 1000*cl->sendcost);
+		if (sv_adaptiverate.value && cl->snapinterval)
+			Con_Printf ("  every %3.0f ms, %2i ents, %2.0f%% loss",
+				1000*cl->snapinterval, cl->entbudget, 100*cl->loss);
+		Con_Printf ("\n");
+	}
+}
+
+/*
+================
+SVC_Profile
+
+Connectionless "profile" query for monitoring.  One line per phase of
+name count total_us p50_us p99_us max_us, a line of
+links relinks leafs_kept cells_kept, then one per client of
+client slot userid sendcost_us.
+================
+*/
+void SVC_Profile (void)
+{
+	int			i;
+	profhist_t	*h;
+	client_t	*cl;
+
+	SV_BeginRedirect (RD_PACKET);
+	for (i=0, h=sv_prof ; i<NUM_PROF ; i++, h++)
+		Con_Printf ("%s %i %.0f %.0f %.0f %.0f\n", prof_names[i], h->count,
+			1000000*h->total,
+			1000000*SV_ProfilePercentile (h, 0.5),
+			1000000*SV_ProfilePercentile (h, 0.99),
+			1000000*h->max);
+	Con_Printf ("links %i %i %i\n", sv_linkstats.links,
+		sv_linkstats.leafskips, sv_linkstats.areaskips);
+	for (i=0, cl=svs.clients ; i<MAX_CLIENTS ; i++, cl++)
+	{
+		if (cl->state < cs_connected)
+			continue;
+		Con_Printf ("client %i %i %.0f\n", i, cl->userid, 1000000*cl->sendcost);
+	}
+	SV_EndRedirect ();
+}
+
+/*
+================
+SV_ProfileInit
+================
+*/
+void SV_ProfileInit (void)
+{
+	Cvar_RegisterVariable (&sv_profile);
+	Cmd_AddCommand ("profile", SV_Profile_f);
+}
@@ -40,6 +40,8 @@ char	outputbuf[8000];
 redirect_t	sv_redirected;
 
 extern cvar_t sv_phs;
+extern cvar_t sv_specshare;
+extern cvar_t sv_adaptiverate;
 
 /*
 ==================
@@ -240,6 +242,27 @@ void SV_BroadcastCommand (char *fmt, ...)
 }
 
 
+/*
+=================
+SV_ClientLeaf
+
+The leaf the client is in, only looked up again once it moves
+=================
+*/
+static mleaf_t *SV_ClientLeaf (client_t *client)
+{
+	float	*org;
+
+	org = client->edict->v.origin;
+	if (client->leafspawncount != svs.spawncount || !VectorCompare (org, client->leaforigin))
+	{
+		client->leaf = Mod_PointInLeaf (org, sv.worldmodel);
+		VectorCopy (org, client->leaforigin);
+		client->leafspawncount = svs.spawncount;
+	}
+	return client->leaf;
+}
+
 /*
 =================
 SV_Multicast
@@ -300,6 +323,9 @@ void SV_Multicast (vec3_t origin, int to)
 		if (client->state != cs_spawned)
 			continue;
 
+		if (mask == sv.pvs)
+			goto inrange;	// every leaf is set in row 0
+
 		if (to == MULTICAST_PHS_R || to == MULTICAST_PHS) {
 			vec3_t delta;
 			VectorSubtract(origin, client->edict->v.origin, delta);
@@ -307,7 +333,7 @@ void SV_Multicast (vec3_t origin, int to)
 				goto inrange;
 		}
 
-		leaf = Mod_PointInLeaf (client->edict->v.origin, sv.worldmodel);
+		leaf = SV_ClientLeaf (client);
 		if (leaf)
 		{
 			// -1 is because pvs rows are 1 based, not 0 based like leafs
@@ -563,50 +589,50 @@ void SV_UpdateClientStats (client_t *client)
 
 /*
 =======================
-SV_SendClientDatagram
+SV_BuildClientDatagram
+
+The expensive part of a client's datagram.  Nothing here touches another
+client or prints, so it is run for several clients at once.
 =======================
 */
-qboolean SV_SendClientDatagram (client_t *client)
+void SV_BuildClientDatagram (client_t *client, sizebuf_t *msg, sv_scratch_t *sc)
 {
-	byte		buf[MAX_DATAGRAM];
-	sizebuf_t	msg;
-
-	msg.data = buf;
-	msg.maxsize = sizeof(buf);
-	msg.cursize = 0;
-	msg.allowoverflow = true;
-	msg.overflowed = false;
-
 	// add the client specific data to the datagram
-	SV_WriteClientdataToMessage (client, &msg);
+	SV_WriteClientdataToMessage (client, msg);
 
 	// send over all the objects that are in the PVS
 	// this will include clients, a packetentities, and
 	// possibly a nails update
-	SV_WriteEntitiesToClient (client, &msg);
+	SV_WriteEntitiesToClient (client, msg, sc);
+}
 
+/*
+=======================
+SV_FinishClientDatagram
+=======================
+*/
+void SV_FinishClientDatagram (client_t *client, sizebuf_t *msg)
+{
 	// copy the accumulated multicast datagram
 	// for this client out to the message
 	if (client->datagram.overflowed)
 		Con_Printf ("WARNING: datagram overflowed for %s\n", client->name);
 	else
-		SZ_Write (&msg, client->datagram.data, client->datagram.cursize);
+		SZ_Write (msg, client->datagram.data, client->datagram.cursize);
 	SZ_Clear (&client->datagram);
 
 	// send deltas over reliable stream
 	if (Netchan_CanReliable (&client->netchan))
 		SV_UpdateClientStats (client);
 
-	if (msg.overflowed)
+	if (msg->overflowed)
 	{
 		Con_Printf ("WARNING: msg overflowed for %s\n", client->name);
-		SZ_Clear (&msg);
+		SZ_Clear (msg);
 	}
 
 	// send the datagram
-	Netchan_Transmit (&client->netchan, msg.cursize, buf);
-
-	return true;
+	Netchan_Transmit (&client->netchan, msg->cursize, msg->data);
 }
 
 /*
@@ -692,20 +718,227 @@ void SV_UpdateToReliableMessages (void)
 
 
 
+// clients that get a packet this frame, in slot order
+typedef struct
+{
+	client_t	*client;
+	sizebuf_t	msg;
+	byte		buf[MAX_DATAGRAM];
+
+	int			group;		// spectator group key, 0 = built alone
+	int			next;		// next sv_outgoing in the group, -1 = last
+} sv_outgoing_t;
+
+static sv_outgoing_t	sv_outgoing[MAX_CLIENTS];
+
+static int		sv_jobs[MAX_CLIENTS];	// first sv_outgoing of each build job
+static int		sv_numjobs;
+
+/*
+=======================
+SV_SpectatorGroup
+
+Spectators tracking the same player share a group, as do free flying
+spectators in the same leaf
+=======================
+*/
+static int SV_SpectatorGroup (client_t *c)
+{
+	vec3_t	org;
+	int		proj;
+
+	if (!sv_specshare.value || !c->spectator || c->state != cs_spawned)
+		return 0;
+
+	// those that take svc_projectiles get a different update
+	proj = c->projectiles ? MAX_MAP_LEAFS : 0;
+
+	if (c->spec_track > 0 && svs.clients[c->spec_track - 1].state == cs_spawned)
+		return c->spec_track + proj;
+
+	VectorAdd (c->edict->v.origin, c->edict->v.view_ofs, org);
+	return -1 - (Mod_PointInLeaf (org, sv.worldmodel) - sv.worldmodel->leafs) - proj;
+}
+
+/*
+=======================
+SV_GroupJobs
+
+Makes one build job for every client, except that spectators in the same
+group go into a single job
+=======================
+*/
+static void SV_GroupJobs (int numout)
+{
+	int		i, j;
+	sv_outgoing_t	*out, *tail;
+
+	sv_numjobs = 0;
+	for (i=0, out = sv_outgoing ; i<numout ; i++, out++)
+	{
+		out->group = SV_SpectatorGroup (out->client);
+		out->next = -1;
+
+		if (out->group)
+		{
+			for (j=0 ; j<sv_numjobs ; j++)
+				if (sv_outgoing[sv_jobs[j]].group == out->group)
+					break;
+			if (j < sv_numjobs)
+			{
+				for (tail = &sv_outgoing[sv_jobs[j]] ; tail->next >= 0 ; tail = &sv_outgoing[tail->next])
+					;
+				tail->next = i;
+				continue;
+			}
+		}
+
+		sv_jobs[sv_numjobs++] = i;
+	}
+}
+
+/*
+=======================
+SV_BuildDatagramJob
+=======================
+*/
+static void SV_BuildDatagramJob (int worker, int job)
+{
+	sv_outgoing_t	*out;
+	client_t	*clients[MAX_CLIENTS];
+	sizebuf_t	*msgs[MAX_CLIENTS];
+	int			i, count;
+	double		start, cost;
+
+	start = sv_profile.value ? Sys_DoubleTime () : 0;
+
+	out = &sv_outgoing[sv_jobs[job]];
+	if (!out->group)
+	{
+		if (out->client->state == cs_spawned)
+			SV_BuildClientDatagram (out->client, &out->msg, &sv_scratch[worker]);
+		if (start)
+			SV_ClientSendCost (out->client, Sys_DoubleTime () - start);
+		return;
+	}
+
+	for (count=0 ; ; out = &sv_outgoing[out->next])
+	{
+		SV_WriteClientdataToMessage (out->client, &out->msg);
+		clients[count] = out->client;
+		msgs[count] = &out->msg;
+		count++;
+		if (out->next < 0)
+			break;
+	}
+	SV_WriteEntitiesToSpectators (clients, msgs, count, &sv_scratch[worker]);
+
+	// the group was built together, so split the cost evenly
+	if (start)
+	{
+		cost = (Sys_DoubleTime () - start) / count;
+		for (i=0 ; i<count ; i++)
+			SV_ClientSendCost (clients[i], cost);
+	}
+}
+
+/*
+=============================================================================
+
+With sv_adaptiverate on, a spawned client isn't sent an update every time
+it sends a move and the line has room.  Instead updates are spaced by the
+time its rate needs to carry an average one, stretched when packets are
+being lost or acks come back later than they used to.  When that would be
+slower than ten a second, the updates get fewer entities instead, so a
+low rate player sees steady small updates rather than choke and burst.
+
+=============================================================================
+*/
+
+#define	ADAPT_MAXINTERVAL	0.1		// never fewer updates a second than this
+#define	ADAPT_MINENTITIES	16
+
+/*
+=======================
+SV_AdaptRate
+
+Called after an update has gone to the client
+=======================
+*/
+static void SV_AdaptRate (client_t *c)
+{
+	int		size, acked, seq;
+	float	interval, ping;
+
+	size = c->netchan.outgoing_size[c->netchan.outgoing_sequence & (MAX_LATENT-1)];
+	c->avgsize = c->avgsize ? c->avgsize*0.9 + size*0.1 : size;
+
+	// the client acks the newest update it got, and is sent at most one
+	// per move, so sequences it skipped over were lost on the way to it.
+	// paced and choked updates are never given a sequence, so don't count.
+	acked = c->netchan.incoming_acknowledged;
+	if (acked > c->lastacked && acked - c->lastacked <= UPDATE_BACKUP)
+	{
+		for (seq = c->lastacked + 1 ; seq < acked ; seq++)
+			c->loss = c->loss*0.9 + 0.1;
+		c->loss *= 0.9;
+	}
+	c->lastacked = acked;	// a jump either way is a reconnect, so resync
+
+	// queueing on the way shows as acks taking longer than the best seen,
+	// which drifts up slowly in case the route changed
+	ping = c->frames[acked & UPDATE_MASK].ping_time;
+	if (ping > 0)
+	{
+		c->minping += 0.0005;
+		if (!c->avgping || ping < c->minping)
+			c->minping = ping;
+		c->avgping = c->avgping ? c->avgping*0.9 + ping*0.1 : ping;
+	}
+
+	interval = c->avgsize * c->netchan.rate * (1 + 4*c->loss);
+	if (c->avgping > c->minping + 0.05)
+		interval *= 1.25;
+
+	if (interval > ADAPT_MAXINTERVAL)
+	{
+		c->entbudget = MAX_PACKET_ENTITIES * ADAPT_MAXINTERVAL / interval;
+		if (c->entbudget < ADAPT_MINENTITIES)
+			c->entbudget = ADAPT_MINENTITIES;
+		interval = ADAPT_MAXINTERVAL;
+	}
+	else
+		c->entbudget = MAX_PACKET_ENTITIES;
+
+	// keep the average spacing without letting a late one cause a burst
+	c->snapinterval = interval;
+	c->nextsnapshot += interval;
+	if (c->nextsnapshot < realtime + interval*0.5)
+		c->nextsnapshot = realtime + interval*0.5;
+}
+
 /*
 =======================
 SV_SendClientMessages
+
+Drops, backbufs and chokes are handled first, then the datagrams of all
+the clients being sent to are built with Sys_RunParallel, and finally
+they are transmitted in slot order.
 =======================
 */
 void SV_SendClientMessages (void)
 {
 	int			i, j;
 	client_t	*c;
+	int			numout;
+	sv_outgoing_t	*out;
+	double		start;
 
 // update frags, names, etc
 	SV_UpdateToReliableMessages ();
 
-// build individual updates
+// find who gets a packet
+	numout = 0;
 	for (i=0, c = svs.clients ; i<MAX_CLIENTS ; i++, c++)
 	{
 		if (!c->state)
@@ -765,17 +998,49 @@ void SV_SendClientMessages (void)
 		if (!c->send_message)
 			continue;
 		c->send_message = false;	// try putting this after choke?
+		if (sv_adaptiverate.value && c->state == cs_spawned && !sv.paused
+			&& realtime < c->nextsnapshot)
+		{
+			c->chokecount++;	// so r_netgraph doesn't show it as loss
+			continue;		// paced, not time for the next update yet
+		}
 		if (!sv.paused && !Netchan_CanPacket (&c->netchan))
 		{
 			c->chokecount++;
 			continue;		// bandwidth choke
 		}
 
+		out = &sv_outgoing[numout++];
+		out->client = c;
+		out->msg.data = out->buf;
+		out->msg.maxsize = sizeof(out->buf);
+		out->msg.cursize = 0;
+		out->msg.allowoverflow = true;
+		out->msg.overflowed = false;
+	}
+
+// build individual updates, all from the entity state as it is now,
+// after the player moves and console commands of this frame
+	if (numout)
+		SV_ExtractEntities ();
+	SV_GroupJobs (numout);
+	Sys_RunParallel (SV_BuildDatagramJob, sv_numjobs);
+
+// and send them
+	for (i=0, out = sv_outgoing ; i<numout ; i++, out++)
+	{
+		c = out->client;
+		start = sv_profile.value ? Sys_DoubleTime () : 0;
 		if (c->state == cs_spawned)
-			SV_SendClientDatagram (c);
+		{
+			SV_FinishClientDatagram (c, &out->msg);
+			if (sv_adaptiverate.value)
+				SV_AdaptRate (c);
+		}
 		else
 			Netchan_Transmit (&c->netchan, 0, NULL);	// just update reliable
-			
+		if (start)
+			SV_ClientSendCost (c, Sys_DoubleTime () - start);
 	}
 }
 
@@ -116,6 +116,100 @@ void SV_New_f (void)
 	MSG_WriteString (&host_client->netchan.message, va("fullserverinfo \"%s\"\n", svs.info) );
 }
 
+/*
+==================
+SV_WriteList
+
+Writes a svc_soundlist or svc_modellist starting at list index n, with
+names added until maxsize bytes have been written.  Returns the index the
+client should ask for next, or 0 when the list is complete.
+==================
+*/
+static int SV_WriteList (sizebuf_t *msg, int cmd, char **list, int n, int maxsize)
+{
+	char	**s;
+	int		start;
+
+	start = msg->cursize;
+	MSG_WriteByte (msg, cmd);
+	MSG_WriteByte (msg, n);
+	for (s = list+1+n ; *s && msg->cursize - start < maxsize ; s++, n++)
+		MSG_WriteString (msg, *s);
+	MSG_WriteByte (msg, 0);
+
+	// next msg
+	if (!*s)
+		n = 0;
+	MSG_WriteByte (msg, n);
+	return n;
+}
+
+/*
+==================
+SV_BuildListChunks
+==================
+*/
+static int SV_BuildListChunks (int cmd, char **list, listchunk_t *chunks)
+{
+	int		i, n;
+
+	n = 0;
+	for (i=0 ; i<MAX_LIST_CHUNKS ; i++)
+	{
+		chunks[i].start = n;
+		chunks[i].offset = sv.lists.cursize;
+		n = SV_WriteList (&sv.lists, cmd, list, n, SIGNON_CHUNK - MAX_QPATH);
+		chunks[i].size = sv.lists.cursize - chunks[i].offset;
+		if (!n)
+			return i+1;
+	}
+	return i;
+}
+
+/*
+==================
+SV_BuildLists
+
+Serializes the soundlist and modellist replies once per level, as full
+as a reliable message allows, instead of for every connecting client
+==================
+*/
+void SV_BuildLists (void)
+{
+	SZ_Clear (&sv.lists);
+	sv.num_sound_chunks = SV_BuildListChunks (svc_soundlist,
+		sv.sound_precache, sv.sound_chunks);
+	sv.num_model_chunks = SV_BuildListChunks (svc_modellist,
+		sv.model_precache, sv.model_chunks);
+}
+
+/*
+==================
+SV_SendList
+
+Sends the prebuilt chunk starting at n if there is one and it fits,
+otherwise builds the reply the slow way
+==================
+*/
+static void SV_SendList (int cmd, char **list, int n, listchunk_t *chunks, int numchunks)
+{
+	sizebuf_t	*msg;
+	int			i;
+
+	msg = &host_client->netchan.message;
+	for (i=0 ; i<numchunks ; i++)
+	{
+		if (chunks[i].start != n)
+			continue;
+		if (msg->cursize + chunks[i].size > msg->maxsize)
+			break;
+		SZ_Write (msg, sv.lists_buf + chunks[i].offset, chunks[i].size);
+		return;
+	}
+
+	SV_WriteList (msg, cmd, list, n, MAX_MSGLEN/2 - msg->cursize);
+}
+
 /*
 ==================
 SV_Soundlist_f
@@ -123,7 +217,6 @@ SV_Soundlist_f
 */
 void SV_Soundlist_f (void)
 {
-	char		**s;
 	int			n;
 
 	if (host_client->state != cs_connected)
@@ -150,20 +243,8 @@ void SV_Soundlist_f (void)
 		SZ_Clear(&host_client->netchan.message);
 	}
 
-	MSG_WriteByte (&host_client->netchan.message, svc_soundlist);
-	MSG_WriteByte (&host_client->netchan.message, n);
-	for (s = sv.sound_precache+1 + n ; 
-		*s && host_client->netchan.message.cursize < (MAX_MSGLEN/2); 
-		s++, n++)
-		MSG_WriteString (&host_client->netchan.message, *s);
-
-	MSG_WriteByte (&host_client->netchan.message, 0);
-
-	// next msg
-	if (*s)
-		MSG_WriteByte (&host_client->netchan.message, n);
-	else
-		MSG_WriteByte (&host_client->netchan.message, 0);
+	SV_SendList (svc_soundlist, sv.sound_precache, n,
+		sv.sound_chunks, sv.num_sound_chunks);
 }
 
 /*
@@ -173,7 +254,6 @@ SV_Modellist_f
 */
 void SV_Modellist_f (void)
 {
-	char		**s;
 	int			n;
 
 	if (host_client->state != cs_connected)
@@ -200,19 +280,8 @@ void SV_Modellist_f (void)
 		SZ_Clear(&host_client->netchan.message);
 	}
 
-	MSG_WriteByte (&host_client->netchan.message, svc_modellist);
-	MSG_WriteByte (&host_client->netchan.message, n);
-	for (s = sv.model_precache+1+n ; 
-		*s && host_client->netchan.message.cursize < (MAX_MSGLEN/2); 
-		s++, n++)
-		MSG_WriteString (&host_client->netchan.message, *s);
-	MSG_WriteByte (&host_client->netchan.message, 0);
-
-	// next msg
-	if (*s)
-		MSG_WriteByte (&host_client->netchan.message, n);
-	else
-		MSG_WriteByte (&host_client->netchan.message, 0);
+	SV_SendList (svc_modellist, sv.model_precache, n,
+		sv.model_chunks, sv.num_model_chunks);
 }
 
 /*
@@ -270,8 +339,8 @@ void SV_PreSpawn_f (void)
 	}
 
 	SZ_Write (&host_client->netchan.message, 
-		sv.signon_buffers[buf],
-		sv.signon_buffer_size[buf]);
+		sv.signon_buf + sv.signon_chunk[buf],
+		sv.signon_chunk[buf+1] - sv.signon_chunk[buf]);
 
 	buf++;
 	if (buf == sv.num_signon_buffers)
@@ -1229,69 +1298,137 @@ float V_CalcRoll (vec3_t angles, vec3_t velocity)
 
 vec3_t	pmove_mins, pmove_maxs;
 
+#define	PHYS_MARGIN		128		// gathered this far past the pmove box
+
+/*
+====================
+SV_AddPhysent
+====================
+*/
+static void SV_AddPhysent (playermove_t *pm, edict_t *check, int pl)
+{
+	physent_t	*pe;
+
+	if (check->v.owner == pl)
+		return;		// player's own missile
+	if (check->v.solid != SOLID_BSP
+		&& check->v.solid != SOLID_BBOX
+		&& check->v.solid != SOLID_SLIDEBOX)
+		return;
+	if (pm->numphysent == MAX_PHYSENTS)
+		return;
+
+	pe = &pm->physents[pm->numphysent];
+	pm->numphysent++;
+
+	VectorCopy (check->v.origin, pe->origin);
+	pe->info = NUM_FOR_EDICT(check);
+	if (check->v.solid == SOLID_BSP)
+		pe->model = sv.models[(int)(check->v.modelindex)];
+	else
+	{
+		pe->model = NULL;
+		VectorCopy (check->v.mins, pe->mins);
+		VectorCopy (check->v.maxs, pe->maxs);
+	}
+}
+
+/*
+====================
+SV_TouchesPmove
+
+The same test SV_AreaEdicts makes of the linked box
+====================
+*/
+static qboolean SV_TouchesPmove (edict_t *check)
+{
+	return !(pmove_mins[0] > check->v.absmax[0]
+		|| pmove_mins[1] > check->v.absmax[1]
+		|| pmove_mins[2] > check->v.absmax[2]
+		|| pmove_maxs[0] < check->v.absmin[0]
+		|| pmove_maxs[1] < check->v.absmin[1]
+		|| pmove_maxs[2] < check->v.absmin[2]);
+}
+
+/*
+====================
+SV_PhysentsCurrent
+====================
+*/
+static qboolean SV_PhysentsCurrent (void)
+{
+	int		i;
+
+	if (!host_client->physvalid)
+		return false;
+	for (i=0 ; i<3 ; i++)
+		if (pmove_mins[i] < host_client->physmins[i]
+			|| pmove_maxs[i] > host_client->physmaxs[i])
+			return false;
+	return true;
+}
+
 /*
 ====================
 AddLinksToPmove
 
+The other players move with every command and are checked each time.
+Everything else is gathered from the area grid for a larger box and
+kept in the client until something solid is linked or unlinked within
+that box or the player leaves it, so the commands of a packet, and of
+later frames in a quiet spot, don't query the grid again.  A spot with
+more than MAX_PHYSCACHE of them is gathered every time.
 ====================
 */
-void AddLinksToPmove ( areanode_t *node )
+void AddLinksToPmove (playermove_t *pm)
 {
-	link_t		*l, *next;
-	edict_t		*check;
+	edict_t		*list[MAX_EDICTS], *check;
 	int			pl;
-	int			i;
-	physent_t	*pe;
+	int			i, e, num;
 
 	pl = EDICT_TO_PROG(sv_player);
 
-	// touch linked edicts
-	for (l = node->solid_edicts.next ; l != &node->solid_edicts ; l = next)
+	for (e=1 ; e<=MAX_CLIENTS ; e++)
 	{
-		next = l->next;
-		check = EDICT_FROM_AREA(l);
+		check = EDICT_NUM(e);
+		if (check == sv_player || SV_AreaType (check) != AREA_SOLID)
+			continue;
+		if (SV_TouchesPmove (check))
+			SV_AddPhysent (pm, check, pl);
+	}
 
-		if (check->v.owner == pl)
-			continue;		// player's own missile
-		if (check->v.solid == SOLID_BSP 
-			|| check->v.solid == SOLID_BBOX 
-			|| check->v.solid == SOLID_SLIDEBOX)
+	if (SV_PhysentsCurrent ())
+	{
+		for (i=0 ; i<host_client->numphysents ; i++)
 		{
-			if (check == sv_player)
-				continue;
-
-			for (i=0 ; i<3 ; i++)
-				if (check->v.absmin[i] > pmove_maxs[i]
-				|| check->v.absmax[i] < pmove_mins[i])
-					break;
-			if (i != 3)
-				continue;
-			if (pmove.numphysent == MAX_PHYSENTS)
-				return;
-			pe = &pmove.physents[pmove.numphysent];
-			pmove.numphysent++;
-
-			VectorCopy (check->v.origin, pe->origin);
-			pe->info = NUM_FOR_EDICT(check);
-			if (check->v.solid == SOLID_BSP)
-				pe->model = sv.models[(int)(check->v.modelindex)];
-			else
-			{
-				pe->model = NULL;
-				VectorCopy (check->v.mins, pe->mins);
-				VectorCopy (check->v.maxs, pe->maxs);
-			}
+			check = EDICT_NUM(host_client->physents[i]);
+			if (SV_TouchesPmove (check))
+				SV_AddPhysent (pm, check, pl);
 		}
-	}
-	
-// recurse down both sides
-	if (node->axis == -1)
 		return;
+	}
 
-	if ( pmove_maxs[node->axis] > node->dist )
-		AddLinksToPmove ( node->children[0] );
-	if ( pmove_mins[node->axis] < node->dist )
-		AddLinksToPmove ( node->children[1] );
+	for (i=0 ; i<3 ; i++)
+	{
+		host_client->physmins[i] = pmove_mins[i] - PHYS_MARGIN;
+		host_client->physmaxs[i] = pmove_maxs[i] + PHYS_MARGIN;
+	}
+	num = SV_AreaEdicts (host_client->physmins, host_client->physmaxs,
+		list, MAX_EDICTS, AREA_SOLID);
+	host_client->numphysents = 0;
+	host_client->physvalid = true;
+	for (i=0 ; i<num ; i++)
+	{
+		e = NUM_FOR_EDICT(list[i]);
+		if (e <= MAX_CLIENTS)
+			continue;
+		if (host_client->numphysents < MAX_PHYSCACHE)
+			host_client->physents[host_client->numphysents++] = e;
+		else
+			host_client->physvalid = false;	// too crowded to keep
+		if (SV_TouchesPmove (list[i]))
+			SV_AddPhysent (pm, list[i], pl);
+	}
 }
 
 
@@ -1302,7 +1439,7 @@ AddAllEntsToPmove
 For debugging
 ================
 */
-void AddAllEntsToPmove (void)
+void AddAllEntsToPmove (playermove_t *pm)
 {
 	int			e;
 	edict_t		*check;
@@ -1331,10 +1468,10 @@ void AddAllEntsToPmove (void)
 					break;
 			if (i != 3)
 				continue;
-			pe = &pmove.physents[pmove.numphysent];
+			pe = &pm->physents[pm->numphysent];
 
 			VectorCopy (check->v.origin, pe->origin);
-			pmove.physents[pmove.numphysent].info = e;
+			pe->info = e;
 			if (check->v.solid == SOLID_BSP)
 				pe->model = sv.models[(int)(check->v.modelindex)];
 			else
@@ -1344,7 +1481,7 @@ void AddAllEntsToPmove (void)
 				VectorCopy (check->v.maxs, pe->maxs);
 			}
 
-			if (++pmove.numphysent == MAX_PHYSENTS)
+			if (++pm->numphysent == MAX_PHYSENTS)
 				break;
 		}
 	}
@@ -1365,29 +1502,54 @@ void SV_PreRunCmd(void)
 
 /*
 ===========
-SV_RunCmd
+SV_SetupPmove
+
+pm set up from sv_player as it is now, with the physents around it
 ===========
 */
-void SV_RunCmd (usercmd_t *ucmd)
+static void SV_SetupPmove (usercmd_t *ucmd, playermove_t *pm, movevars_t *mv)
 {
-	edict_t		*ent;
-	int			i, n;
-	int			oldmsec;
+	int			i;
 
-	cmd = *ucmd;
+	for (i=0 ; i<3 ; i++)
+		pm->origin[i] = sv_player->v.origin[i] + (sv_player->v.mins[i] - player_mins[i]);
+	VectorCopy (sv_player->v.velocity, pm->velocity);
+	VectorCopy (sv_player->v.v_angle, pm->angles);
+
+	pm->spectator = host_client->spectator;
+	pm->waterjumptime = sv_player->v.teleport_time;
+	pm->numphysent = 1;
+	pm->physents[0].model = sv.worldmodel;
+	pm->cmd = *ucmd;
+	pm->dead = sv_player->v.health <= 0;
+	pm->oldbuttons = host_client->oldbuttons;
+
+	mv->entgravity = host_client->entgravity;
+	mv->maxspeed = host_client->maxspeed;
+	pm->movevars = mv;
 
-	// chop up very long commands
-	if (cmd.msec > 50)
+	for (i=0 ; i<3 ; i++)
 	{
-		oldmsec = ucmd->msec;
-		cmd.msec = oldmsec/2;
-		SV_RunCmd (&cmd);
-		cmd.msec = oldmsec/2;
-		cmd.impulse = 0;
-		SV_RunCmd (&cmd);
-		return;
+		pmove_mins[i] = pm->origin[i] - 256;
+		pmove_maxs[i] = pm->origin[i] + 256;
 	}
+#if 1
+	AddLinksToPmove (pm);
+#else
+	AddAllEntsToPmove (pm);
+#endif
+}
 
+/*
+===========
+SV_BeginCmd
+
+Everything of a command up to the move itself: the QC pre-think and
+pm set up from sv_player with the physents around it
+===========
+*/
+static void SV_BeginCmd (usercmd_t *ucmd, playermove_t *pm, movevars_t *mv)
+{
 	if (!sv_player->v.fixangle)
 		VectorCopy (ucmd->angles, sv_player->v.v_angle);
 
@@ -1425,71 +1587,63 @@ void SV_RunCmd (usercmd_t *ucmd)
 		SV_RunThink (sv_player);
 	}
 
-	for (i=0 ; i<3 ; i++)
-		pmove.origin[i] = sv_player->v.origin[i] + (sv_player->v.mins[i] - player_mins[i]);
-	VectorCopy (sv_player->v.velocity, pmove.velocity);
-	VectorCopy (sv_player->v.v_angle, pmove.angles);
-
-	pmove.spectator = host_client->spectator;
-	pmove.waterjumptime = sv_player->v.teleport_time;
-	pmove.numphysent = 1;
-	pmove.physents[0].model = sv.worldmodel;
-	pmove.cmd = *ucmd;
-	pmove.dead = sv_player->v.health <= 0;
-	pmove.oldbuttons = host_client->oldbuttons;
+	SV_SetupPmove (ucmd, pm, mv);
+}
 
-	movevars.entgravity = host_client->entgravity;
-	movevars.maxspeed = host_client->maxspeed;
+/*
+===========
+SV_TouchedPlayer
+===========
+*/
+static qboolean SV_TouchedPlayer (playermove_t *pm)
+{
+	int		i, n;
 
-	for (i=0 ; i<3 ; i++)
+	for (i=0 ; i<pm->numtouch ; i++)
 	{
-		pmove_mins[i] = pmove.origin[i] - 256;
-		pmove_maxs[i] = pmove.origin[i] + 256;
+		n = pm->physents[pm->touchindex[i]].info;
+		if (n >= 1 && n <= MAX_CLIENTS)
+			return true;
 	}
-#if 1
-	AddLinksToPmove ( sv_areanodes );
-#else
-	AddAllEntsToPmove ();
-#endif
-
-#if 0
-{
-	int before, after;
+	return false;
+}
 
-before = PM_TestPlayerPosition (pmove.origin);
-	PlayerMove ();
-after = PM_TestPlayerPosition (pmove.origin);
+/*
+===========
+SV_EndCmd
 
-if (sv_player->v.health > 0 && before && !after )
-	Con_Printf ("player %s got stuck in playermove!!!!\n", host_client->name);
-}
-#else
-	PlayerMove ();
-#endif
+Copies the result of the move back to sv_player, links it and runs
+the touches of everything it ran into that isn't set in touched yet
+===========
+*/
+static void SV_EndCmd (playermove_t *pm, byte *touched)
+{
+	edict_t		*ent;
+	int			i, n;
 
-	host_client->oldbuttons = pmove.oldbuttons;
-	sv_player->v.teleport_time = pmove.waterjumptime;
-	sv_player->v.waterlevel = waterlevel;
-	sv_player->v.watertype = watertype;
-	if (onground != -1)
+	host_client->oldbuttons = pm->oldbuttons;
+	sv_player->v.teleport_time = pm->waterjumptime;
+	sv_player->v.waterlevel = pm->waterlevel;
+	sv_player->v.watertype = pm->watertype;
+	if (pm->onground != -1)
 	{
 		sv_player->v.flags = (int)sv_player->v.flags | FL_ONGROUND;
-		sv_player->v.groundentity = EDICT_TO_PROG(EDICT_NUM(pmove.physents[onground].info));
+		sv_player->v.groundentity = EDICT_TO_PROG(EDICT_NUM(pm->physents[pm->onground].info));
 	}
 	else
 		sv_player->v.flags = (int)sv_player->v.flags & ~FL_ONGROUND;
 	for (i=0 ; i<3 ; i++)
-		sv_player->v.origin[i] = pmove.origin[i] - (sv_player->v.mins[i] - player_mins[i]);
+		sv_player->v.origin[i] = pm->origin[i] - (sv_player->v.mins[i] - player_mins[i]);
 
 #if 0
 	// truncate velocity the same way the net protocol will
 	for (i=0 ; i<3 ; i++)
-		sv_player->v.velocity[i] = (int)pmove.velocity[i];
+		sv_player->v.velocity[i] = (int)pm->velocity[i];
 #else
-	VectorCopy (pmove.velocity, sv_player->v.velocity);
+	VectorCopy (pm->velocity, sv_player->v.velocity);
 #endif
 
-	VectorCopy (pmove.angles, sv_player->v.v_angle);
+	VectorCopy (pm->angles, sv_player->v.v_angle);
 
 	if (!host_client->spectator)
 	{
@@ -1497,20 +1651,63 @@ if (sv_player->v.health > 0 && before && !after )
 		SV_LinkEdict (sv_player, true);
 
 		// touch other objects
-		for (i=0 ; i<pmove.numtouch ; i++)
+		for (i=0 ; i<pm->numtouch ; i++)
 		{
-			n = pmove.physents[pmove.touchindex[i]].info;
+			n = pm->physents[pm->touchindex[i]].info;
 			ent = EDICT_NUM(n);
-			if (!ent->v.touch || (playertouch[n/8]&(1<<(n%8))))
+			if (!ent->v.touch || (touched[n/8]&(1<<(n%8))))
 				continue;
 			pr_global_struct->self = EDICT_TO_PROG(ent);
 			pr_global_struct->other = EDICT_TO_PROG(sv_player);
 			PR_ExecuteProgram (ent->v.touch);
-			playertouch[n/8] |= 1 << (n%8);
+			touched[n/8] |= 1 << (n%8);
 		}
 	}
 }
 
+/*
+===========
+SV_RunCmd
+===========
+*/
+void SV_RunCmd (usercmd_t *ucmd)
+{
+	int			oldmsec;
+
+	cmd = *ucmd;
+
+	// chop up very long commands
+	if (cmd.msec > 50)
+	{
+		oldmsec = ucmd->msec;
+		cmd.msec = oldmsec/2;
+		SV_RunCmd (&cmd);
+		cmd.msec = oldmsec/2;
+		cmd.impulse = 0;
+		SV_RunCmd (&cmd);
+		return;
+	}
+
+	SV_BeginCmd (ucmd, &pmove, &movevars);
+
+#if 0
+{
+	int before, after;
+
+before = PM_TestPlayerPosition (&pmove, pmove.origin);
+	PM_Move (&pmove);
+after = PM_TestPlayerPosition (&pmove, pmove.origin);
+
+if (sv_player->v.health > 0 && before && !after )
+	Con_Printf ("player %s got stuck in playermove!!!!\n", host_client->name);
+}
+#else
+	PM_Move (&pmove);
+#endif
+
+	SV_EndCmd (&pmove, playertouch);
+}
+
 /*
 ===========
 SV_PostRunCmd
@@ -1533,6 +1730,235 @@ void SV_PostRunCmd(void)
 	}
 }
 
+/*
+============================================================================
+
+PARALLEL PLAYER MOVEMENT
+
+With sv_parallelmove set the commands of a client packet are queued
+instead of run, and SV_RunMoves runs them once all packets of the frame
+are read.  It goes in rounds of one command for every client that has
+any left.  A round sets the moves up in client order, runs all the
+PlayerMoves at once, each against its own copy of the physents, then
+copies the results back, links the players and runs their touches in
+client order again.
+
+Players see each other where they were at the start of the round,
+not wherever the clients before them in the frame got to, which only
+matters when they are close enough to touch.
+
+With sv_parallelmove_verify set, every move of a round is run again
+right before its results are copied back, set up from the world the
+clients before it have already moved in, which is what the serial path
+would have seen.  Only the PlayerMoves are compared, QC still runs once.
+Moves that end with a different origin, velocity or ground without
+either run touching another player are reported, and counted in
+sv_movecheck.
+
+============================================================================
+*/
+
+cvar_t	sv_parallelmove = {"sv_parallelmove", "0"};
+cvar_t	sv_parallelmove_verify = {"sv_parallelmove_verify", "0"};
+
+#define	MAX_MOVECMDS	(20*8)	// up to 20 commands a packet, each chopped up to 8 times
+
+typedef struct
+{
+	int			numcmds;
+	int			current;	// the one in this round
+	usercmd_t	cmds[MAX_MOVECMDS];
+	byte		touched[(MAX_EDICTS+7)/8];
+
+	movevars_t	movevars;
+	playermove_t	pm;
+} clientmove_t;
+
+static clientmove_t	sv_moves[MAX_CLIENTS];
+static clientmove_t	*sv_roundmoves[MAX_CLIENTS];
+static int			sv_numroundmoves;
+static playermove_t	sv_checkmove;	// for sv_parallelmove_verify
+
+movecheck_t		sv_movecheck;
+
+/*
+===========
+SV_QueueCmd
+
+Chops up very long commands the same way SV_RunCmd does
+===========
+*/
+static void SV_QueueCmd (clientmove_t *cm, usercmd_t *ucmd)
+{
+	usercmd_t	half;
+
+	if (ucmd->msec > 50)
+	{
+		half = *ucmd;
+		half.msec = ucmd->msec/2;
+		SV_QueueCmd (cm, &half);
+		half.impulse = 0;
+		SV_QueueCmd (cm, &half);
+		return;
+	}
+
+	if (cm->numcmds == MAX_MOVECMDS)
+		SV_Error ("SV_QueueCmd: MAX_MOVECMDS");
+	cm->cmds[cm->numcmds++] = *ucmd;
+}
+
+/*
+===========
+SV_QueueMoves
+
+The parallel version of running the commands of a packet for host_client
+===========
+*/
+static void SV_QueueMoves (usercmd_t *oldest, usercmd_t *oldcmd, usercmd_t *newcmd)
+{
+	clientmove_t	*cm;
+	int				drop;
+
+	cm = &sv_moves[host_client - svs.clients];
+	if (cm->numcmds)
+		SV_RunMoves ();		// second packet this frame, finish the first
+
+	memset (cm->touched, 0, sizeof(cm->touched));
+
+	drop = net_drop;
+	if (drop < 20)
+	{
+		while (drop > 2)
+		{
+			SV_QueueCmd (cm, &host_client->lastcmd);
+			drop--;
+		}
+		if (drop > 1)
+			SV_QueueCmd (cm, oldest);
+		if (drop > 0)
+			SV_QueueCmd (cm, oldcmd);
+	}
+	SV_QueueCmd (cm, newcmd);
+}
+
+/*
+===========
+SV_PlayerMoveJob
+
+Sys_RunParallel job for one move of the round
+===========
+*/
+static void SV_PlayerMoveJob (int worker, int job)
+{
+	PM_Move (&sv_roundmoves[job]->pm);
+}
+
+/*
+===========
+SV_CheckMove
+
+Runs the move of cm again from the world as it is now and compares
+it with the one the round came up with
+===========
+*/
+static void SV_CheckMove (clientmove_t *cm)
+{
+	playermove_t	*pm;
+	movevars_t		mv;
+
+	pm = &sv_checkmove;
+	mv = cm->movevars;
+	SV_SetupPmove (&cm->cmds[cm->current], pm, &mv);
+	PM_Move (pm);
+
+	if (SV_TouchedPlayer (pm) || SV_TouchedPlayer (&cm->pm))
+	{
+		sv_movecheck.touched++;
+		return;
+	}
+	sv_movecheck.checked++;
+	if (VectorCompare (pm->origin, cm->pm.origin)
+		&& VectorCompare (pm->velocity, cm->pm.velocity)
+		&& (pm->onground == -1) == (cm->pm.onground == -1))
+		return;
+	sv_movecheck.differed++;
+	Con_Printf ("%s: parallel move ended at %5.1f %5.1f %5.1f, serial at %5.1f %5.1f %5.1f\n",
+		host_client->name, cm->pm.origin[0], cm->pm.origin[1], cm->pm.origin[2],
+		pm->origin[0], pm->origin[1], pm->origin[2]);
+}
+
+/*
+===========
+SV_RunMoveRounds
+===========
+*/
+static void SV_RunMoveRounds (void)
+{
+	client_t		*cl;
+	clientmove_t	*cm;
+	int				i;
+
+	do
+	{
+		sv_numroundmoves = 0;
+		for (i=0, cl=svs.clients, cm=sv_moves ; i<MAX_CLIENTS ; i++, cl++, cm++)
+		{
+			if (cm->current == cm->numcmds)
+				continue;
+			if (cl->state != cs_spawned)
+			{	// dropped since the packet was read
+				cm->numcmds = cm->current = 0;
+				continue;
+			}
+
+			host_client = cl;
+			sv_player = cl->edict;
+			cmd = cm->cmds[cm->current];
+			cm->movevars = movevars;
+			SV_BeginCmd (&cmd, &cm->pm, &cm->movevars);
+			sv_roundmoves[sv_numroundmoves++] = cm;
+		}
+
+		Sys_RunParallel (SV_PlayerMoveJob, sv_numroundmoves);
+
+		for (i=0 ; i<sv_numroundmoves ; i++)
+		{
+			cm = sv_roundmoves[i];
+			host_client = svs.clients + (cm - sv_moves);
+			sv_player = host_client->edict;
+			if (sv_parallelmove_verify.value)
+				SV_CheckMove (cm);
+			SV_EndCmd (&cm->pm, cm->touched);
+			if (++cm->current == cm->numcmds)
+			{
+				cm->numcmds = cm->current = 0;
+				SV_PostRunCmd ();
+			}
+		}
+	} while (sv_numroundmoves);
+}
+
+/*
+===========
+SV_RunMoves
+
+Runs the commands queued by SV_QueueMoves
+===========
+*/
+void SV_RunMoves (void)
+{
+	client_t		*oldclient;
+	edict_t			*oldplayer;
+
+	oldclient = host_client;
+	oldplayer = sv_player;
+
+	SV_RunMoveRounds ();
+
+	host_client = oldclient;
+	sv_player = oldplayer;
+}
+
 
 /*
 ===================
@@ -1637,7 +2063,9 @@ void SV_ExecuteClientMessage (client_t *cl)
 				return;
 			}
 
-			if (!sv.paused) {
+			if (!sv.paused && sv_parallelmove.value)
+				SV_QueueMoves (&oldest, &oldcmd, &newcmd);
+			else if (!sv.paused) {
 				SV_PreRunCmd();
 
 				if (net_drop < 20)
@@ -1693,10 +2121,18 @@ SV_UserInit
 */
 void SV_UserInit (void)
 {
+	int		i;
+
 	Cvar_RegisterVariable (&cl_rollspeed);
 	Cvar_RegisterVariable (&cl_rollangle);
 	Cvar_RegisterVariable (&sv_spectalk);
 	Cvar_RegisterVariable (&sv_mapcheck);
+	Cvar_RegisterVariable (&sv_parallelmove);
+	Cvar_RegisterVariable (&sv_parallelmove_verify);
+
+	for (i=0 ; i<MAX_CLIENTS ; i++)
+		CM_InitBoxHull (&sv_moves[i].pm.box);
+	CM_InitBoxHull (&sv_checkmove.box);
 }
 
 
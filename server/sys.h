@@ -33,3 +33,19 @@ void Sys_Quit (void);
 double Sys_DoubleTime (void);
 char *Sys_ConsoleInput (void);
 void Sys_Init (void);
+
+#define	SYS_MAXTHREADS	8
+void Sys_RunParallel (void (*func)(int worker, int job), int numjobs);
+// calls func once for every job, spread over sys_threads threads.  worker
+// is below SYS_MAXTHREADS and unique among the calls running at one time
+
+void Sys_Lock (void);
+void Sys_Unlock (void);
+// guards the few things Sys_RunParallel jobs share
+
+void Sys_JobError (char *error, ...);
+void Sys_JobDPrintf (char *fmt, ...);
+// Sys_Error and Con_DPrintf for code that Sys_RunParallel jobs reach.  In
+// a job the text is kept until the batch is done and then raised or
+// printed by the main thread, so Sys_JobError returns and the caller has
+// to carry on with something harmless
@@ -18,6 +18,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 #include <sys/types.h>
+#include <time.h>
+#include <pthread.h>
 #include "qwsvdef.h"
 
 #ifdef NeXT
@@ -35,9 +37,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 cvar_t	sys_nostdout = {"sys_nostdout","0"};
 cvar_t	sys_extrasleep = {"sys_extrasleep","0"};
+cvar_t	sys_ticrate = {"sys_ticrate","0"};	// physics tics per second, 0 = run on packets
+cvar_t	sys_threads = {"sys_threads","1"};	// threads used by Sys_RunParallel
 
 qboolean	stdin_ready;
 
+static int		secbase;		// Sys_DoubleTime is relative to this
+static double	oldtime;		// when SV_Frame was last run
+static double	nexttic;		// deadline of the next fixed tic
+
+#define	SYS_TICSLACK	0.002	// stop servicing packets this close to a tic
+
 /*
 ===============================================================================
 
@@ -86,9 +96,22 @@ Sys_DoubleTime
 */
 double Sys_DoubleTime (void)
 {
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	// not affected by the wall clock being stepped
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	if (!secbase)
+	{
+		secbase = ts.tv_sec;
+		return ts.tv_nsec/1000000000.0;
+	}
+
+	return (ts.tv_sec - secbase) + ts.tv_nsec/1000000000.0;
+#else
 	struct timeval tp;
 	struct timezone tzp;
-	static int		secbase;
 
 	gettimeofday(&tp, &tzp);
 	
@@ -99,6 +122,243 @@ double Sys_DoubleTime (void)
 	}
 	
 	return (tp.tv_sec - secbase) + tp.tv_usec/1000000.0;
+#endif
+}
+
+/*
+================
+Sys_SleepUntil
+
+Sleeps until Sys_DoubleTime reaches t
+================
+*/
+void Sys_SleepUntil (double t)
+{
+	struct timespec ts;
+#if defined(CLOCK_MONOTONIC) && defined(TIMER_ABSTIME)
+	ts.tv_sec = secbase + (int)t;
+	ts.tv_nsec = (long)((t - (int)t) * 1000000000.0);
+	while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+#else
+	double	wait;
+
+	wait = t - Sys_DoubleTime ();
+	if (wait <= 0)
+		return;
+	ts.tv_sec = (int)wait;
+	ts.tv_nsec = (long)((wait - ts.tv_sec) * 1000000000.0);
+	nanosleep (&ts, NULL);
+#endif
+}
+
+/*
+===============================================================================
+
+				WORKER THREADS
+
+===============================================================================
+*/
+
+static pthread_mutex_t	sys_jobmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	sys_jobcond = PTHREAD_COND_INITIALIZER;	// a batch was started
+static pthread_cond_t	sys_donecond = PTHREAD_COND_INITIALIZER;	// all workers are done
+
+static pthread_t	sys_thread[SYS_MAXTHREADS];
+static int		sys_threadbatch[SYS_MAXTHREADS];	// batch each worker started at
+static int		sys_numthreads;		// started workers, the main thread is worker 0
+
+static void		(*sys_jobfunc)(int worker, int job);
+static int		sys_numjobs;
+static int		sys_nextjob;
+static int		sys_usethreads;		// workers at or above this sit the batch out
+static int		sys_batch;			// bumped for every Sys_RunParallel
+static int		sys_busy;			// workers that haven't finished the batch
+
+static qboolean	sys_injobs;			// a batch is running
+static char		sys_joberror[1024];	// the first Sys_JobError of the batch
+static char		sys_jobtext[1024];	// Sys_JobDPrintf text of the batch
+
+static void Sys_RunJobs (int worker)
+{
+	int		job;
+
+	while (1)
+	{
+		pthread_mutex_lock (&sys_jobmutex);
+		job = sys_nextjob < sys_numjobs ? sys_nextjob++ : -1;
+		pthread_mutex_unlock (&sys_jobmutex);
+		if (job < 0)
+			return;
+		sys_jobfunc (worker, job);
+	}
+}
+
+static void *Sys_WorkerThread (void *arg)
+{
+	int		worker, batch;
+
+	worker = (int *)arg - sys_threadbatch;
+	batch = *(int *)arg;
+
+	pthread_mutex_lock (&sys_jobmutex);
+	while (1)
+	{
+		while (batch == sys_batch)
+			pthread_cond_wait (&sys_jobcond, &sys_jobmutex);
+		batch = sys_batch;
+
+		if (worker < sys_usethreads)
+		{
+			pthread_mutex_unlock (&sys_jobmutex);
+			Sys_RunJobs (worker);
+			pthread_mutex_lock (&sys_jobmutex);
+		}
+
+		if (--sys_busy == 0)
+			pthread_cond_signal (&sys_donecond);
+	}
+	return NULL;
+}
+
+/*
+================
+Sys_EndJobs
+
+Back on the main thread alone, hands on what the jobs had to say
+================
+*/
+static void Sys_EndJobs (void)
+{
+	sys_injobs = false;
+	if (sys_jobtext[0])
+	{
+		Con_Printf ("%s", sys_jobtext);
+		sys_jobtext[0] = 0;
+	}
+	if (sys_joberror[0])
+		Sys_Error ("%s", sys_joberror);
+}
+
+/*
+================
+Sys_RunParallel
+================
+*/
+void Sys_RunParallel (void (*func)(int worker, int job), int numjobs)
+{
+	int		i, use;
+
+	sys_injobs = true;
+
+	use = (int)sys_threads.value;
+	if (use > SYS_MAXTHREADS)
+		use = SYS_MAXTHREADS;
+	if (use <= 1 || numjobs <= 1)
+	{
+		for (i=0 ; i<numjobs ; i++)
+			func (0, i);
+		Sys_EndJobs ();
+		return;
+	}
+
+	// start any workers we don't have yet
+	while (sys_numthreads < use-1)
+	{
+		i = sys_numthreads+1;
+		sys_threadbatch[i] = sys_batch;
+		if (pthread_create (&sys_thread[i], NULL, Sys_WorkerThread, &sys_threadbatch[i]))
+		{
+			Con_Printf ("Sys_RunParallel: couldn't start thread %i\n", i);
+			Cvar_SetValue ("sys_threads", i);
+			use = i;
+			break;
+		}
+		sys_numthreads = i;
+	}
+
+	pthread_mutex_lock (&sys_jobmutex);
+	sys_jobfunc = func;
+	sys_numjobs = numjobs;
+	sys_nextjob = 0;
+	sys_usethreads = use;
+	sys_busy = sys_numthreads;
+	sys_batch++;
+	pthread_cond_broadcast (&sys_jobcond);
+	pthread_mutex_unlock (&sys_jobmutex);
+
+	Sys_RunJobs (0);
+
+	pthread_mutex_lock (&sys_jobmutex);
+	while (sys_busy)
+		pthread_cond_wait (&sys_donecond, &sys_jobmutex);
+	pthread_mutex_unlock (&sys_jobmutex);
+
+	Sys_EndJobs ();
+}
+
+static pthread_mutex_t	sys_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void Sys_Lock (void)
+{
+	pthread_mutex_lock (&sys_lock);
+}
+
+void Sys_Unlock (void)
+{
+	pthread_mutex_unlock (&sys_lock);
+}
+
+/*
+================
+Sys_JobError
+================
+*/
+void Sys_JobError (char *error, ...)
+{
+	va_list		argptr;
+	char		string[1024];
+
+	va_start (argptr,error);
+	vsprintf (string,error,argptr);
+	va_end (argptr);
+
+	if (!sys_injobs)
+		Sys_Error ("%s", string);
+
+	Sys_Lock ();
+	if (!sys_joberror[0])
+		strcpy (sys_joberror, string);
+	Sys_Unlock ();
+}
+
+/*
+================
+Sys_JobDPrintf
+================
+*/
+void Sys_JobDPrintf (char *fmt, ...)
+{
+	va_list		argptr;
+	char		string[1024];
+
+	if (!developer.value)
+		return;
+
+	va_start (argptr,fmt);
+	vsprintf (string,fmt,argptr);
+	va_end (argptr);
+
+	if (!sys_injobs)
+	{
+		Con_Printf ("%s", string);
+		return;
+	}
+
+	Sys_Lock ();
+	if (strlen(sys_jobtext) + strlen(string) < sizeof(sys_jobtext))
+		strcat (sys_jobtext, string);	// dropped once the batch said enough
+	Sys_Unlock ();
 }
 
 /*
@@ -205,6 +465,73 @@ void Sys_Init (void)
 {
 	Cvar_RegisterVariable (&sys_nostdout);
 	Cvar_RegisterVariable (&sys_extrasleep);
+	Cvar_RegisterVariable (&sys_ticrate);
+	Cvar_RegisterVariable (&sys_threads);
+}
+
+/*
+=============
+Sys_RunTic
+
+Used instead of the select loop when sys_ticrate is set.  Packets are
+serviced as they arrive until the next tic is close, then the rest is slept
+out on the deadline itself.  A server that falls a tic or more behind runs
+one longer tic instead of a burst of short ones.
+=============
+*/
+void Sys_RunTic (void)
+{
+	double	tic, ticlen, now, wait;
+	int		skipped;
+	fd_set	fdset;
+	struct timeval	timeout;
+	extern	int		net_socket;
+	extern	cvar_t	sv_maxtic;
+
+	tic = 1.0 / sys_ticrate.value;
+	now = Sys_DoubleTime ();
+	if (!nexttic || now - nexttic > 1.0)
+		nexttic = now;		// just switched on, or stalled for a long time
+
+	// run network only frames until the tic is close
+	while (nexttic - now > SYS_TICSLACK)
+	{
+		wait = nexttic - now - SYS_TICSLACK;
+		FD_ZERO(&fdset);
+		if (do_stdin)
+			FD_SET(0, &fdset);
+		FD_SET(net_socket, &fdset);
+		timeout.tv_sec = (int)wait;
+		timeout.tv_usec = (int)((wait - timeout.tv_sec) * 1000000);
+		if (select (net_socket+1, &fdset, NULL, NULL, &timeout) > 0)
+		{
+			stdin_ready = FD_ISSET(0, &fdset);
+			now = Sys_DoubleTime ();
+			SV_TicFrame (now - oldtime, 0);
+			oldtime = now;
+		}
+		now = Sys_DoubleTime ();
+	}
+
+	Sys_SleepUntil (nexttic);
+	now = Sys_DoubleTime ();
+
+	skipped = 0;
+	if (now - nexttic >= tic)
+	{	// fold the missed tics into this one
+		skipped = (int)((now - nexttic) / tic);
+		nexttic += skipped * tic;
+	}
+	SV_TicStats (now - nexttic, skipped);
+
+	ticlen = tic * (skipped + 1);
+	if (ticlen > sv_maxtic.value)
+		ticlen = sv_maxtic.value;
+
+	stdin_ready = false;
+	SV_TicFrame (now - oldtime, ticlen);
+	oldtime = now;
+	nexttic += tic;
 }
 
 /*
@@ -214,7 +541,7 @@ main
 */
 void main(int argc, char *argv[])
 {
-	double			time, oldtime, newtime;
+	double			time, newtime;
 	quakeparms_t	parms;
 	fd_set	fdset;
 	extern	int		net_socket;
@@ -254,6 +581,12 @@ void main(int argc, char *argv[])
 	oldtime = Sys_DoubleTime () - 0.1;
 	while (1)
 	{
+		if (sys_ticrate.value > 0)
+		{
+			Sys_RunTic ();
+			continue;
+		}
+
 	// select on the net socket and stdin
 	// the only reason we have a timeout at all is so that if the last
 	// connected client times out, the message would not otherwise
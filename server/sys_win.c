@@ -171,6 +171,65 @@ void Sys_Quit (void)
 }
 
 
+/*
+================
+Sys_RunParallel
+
+No worker threads here, the jobs are run in order
+================
+*/
+void Sys_RunParallel (void (*func)(int worker, int job), int numjobs)
+{
+	int		i;
+
+	for (i=0 ; i<numjobs ; i++)
+		func (0, i);
+}
+
+void Sys_Lock (void)
+{
+}
+
+void Sys_Unlock (void)
+{
+}
+
+/*
+================
+Sys_JobError
+
+Jobs run on the main thread here, so nothing needs to wait
+================
+*/
+void Sys_JobError (char *error, ...)
+{
+	va_list		argptr;
+	char		string[1024];
+
+	va_start (argptr,error);
+	vsprintf (string,error,argptr);
+	va_end (argptr);
+
+	Sys_Error ("%s", string);
+}
+
+/*
+================
+Sys_JobDPrintf
+================
+*/
+void Sys_JobDPrintf (char *fmt, ...)
+{
+	va_list		argptr;
+	char		string[1024];
+
+	va_start (argptr,fmt);
+	vsprintf (string,fmt,argptr);
+	va_end (argptr);
+
+	Con_DPrintf ("%s", string);
+}
+
 /*
 =============
 Sys_Init
@@ -42,79 +42,9 @@ typedef struct
 } moveclip_t;
 
 
-int SV_HullPointContents (hull_t *hull, int num, vec3_t p);
-
-/*
-===============================================================================
-
-HULL BOXES
-
-===============================================================================
-*/
-
-
-static	hull_t		box_hull;
-static	dclipnode_t	box_clipnodes[6];
-static	mplane_t	box_planes[6];
-
-/*
-===================
-SV_InitBoxHull
-
-Set up the planes and clipnodes so that the six floats of a bounding box
-can just be stored out and get a proper hull_t structure.
-===================
-*/
-void SV_InitBoxHull (void)
-{
-	int		i;
-	int		side;
-
-	box_hull.clipnodes = box_clipnodes;
-	box_hull.planes = box_planes;
-	box_hull.firstclipnode = 0;
-	box_hull.lastclipnode = 5;
-
-	for (i=0 ; i<6 ; i++)
-	{
-		box_clipnodes[i].planenum = i;
-		
-		side = i&1;
-		
-		box_clipnodes[i].children[side] = CONTENTS_EMPTY;
-		if (i != 5)
-			box_clipnodes[i].children[side^1] = i + 1;
-		else
-			box_clipnodes[i].children[side^1] = CONTENTS_SOLID;
-		
-		box_planes[i].type = i>>1;
-		box_planes[i].normal[i>>1] = 1;
-	}
-	
-}
-
-
-/*
-===================
-SV_HullForBox
-
-To keep everything totally uniform, bounding boxes are turned into small
-BSP trees instead of being compared directly.
-===================
-*/
-hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs)
-{
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = mins[0];
-	box_planes[2].dist = maxs[1];
-	box_planes[3].dist = mins[1];
-	box_planes[4].dist = maxs[2];
-	box_planes[5].dist = mins[2];
-
-	return &box_hull;
-}
-
+static	boxhull_t	sv_box;		// for entities that aren't bsp models
 
+static void SV_StopTraceRecord (void);
 
 /*
 ================
@@ -161,7 +91,7 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 
 		VectorSubtract (ent->v.mins, maxs, hullmins);
 		VectorSubtract (ent->v.maxs, mins, hullmaxs);
-		hull = SV_HullForBox (hullmins, hullmaxs);
+		hull = CM_HullForBox (&sv_box, hullmins, hullmaxs);
 		
 		VectorCopy (ent->v.origin, offset);
 	}
@@ -175,56 +105,457 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 
 ENTITY AREA CHECKING
 
+Linked entities are kept in a loose grid over x and y with a few levels of
+cell size.  An entity goes in the smallest level whose cells are at least
+as wide as its box, in the cell holding the middle of the box, so the box
+never reaches more than half a cell outside that cell.  A query looks at
+every cell its own box reaches once grown by that half cell.  Anything
+wider than the largest cells, or centred off the world, goes in one extra
+cell that every query looks at.  Entity e's link is links[e].
+
 ===============================================================================
 */
 
+#define	AREA_LEVELS		3
+#define	AREA_CELLSIZE	256			// level 0 cells at least this wide
+#define	AREA_LEVELSHIFT	2			// each level 4 times wider
+#define	AREA_SIDE		32			// level 0 cells along x and y
+#define	AREA_CELLS		(32*32 + 8*8 + 2*2 + 1)
+#define	AREA_HUGE		(AREA_CELLS-1)
+
+typedef struct
+{
+	short	prev, next;				// -1 ends the list
+	short	cell;					// -1 when not linked
+	byte	type;					// AREA_SOLID or AREA_TRIGGERS
+	byte	level;					// AREA_LEVELS for the huge cell
+	vec3_t	absmin, absmax;			// as when linked
+} arealink_t;
+
+typedef struct
+{
+	short	first[2];				// solid and trigger lists, -1 if empty
+} areacell_t;
 
-areanode_t	sv_areanodes[AREA_NODES];
-int			sv_numareanodes;
+typedef struct
+{
+	arealink_t	links[MAX_EDICTS];
+	areacell_t	cells[AREA_CELLS];
+	float		origin[2];			// world mins
+	float		cellsize[AREA_LEVELS];
+	float		scale[AREA_LEVELS];	// 1/cellsize
+	int			side[AREA_LEVELS];	// cells along x and y
+	int			firstcell[AREA_LEVELS];
+	int			levelcount[AREA_LEVELS];	// links in each level's cells
+} areagrid_t;
+
+static areagrid_t	sv_area;
 
 /*
 ===============
-SV_CreateAreaNode
+SV_ClearArea
 
+The cells cover mins to maxs, and grow past AREA_CELLSIZE for a world
+too big for AREA_SIDE of them
 ===============
 */
-areanode_t *SV_CreateAreaNode (int depth, vec3_t mins, vec3_t maxs)
+static void SV_ClearArea (areagrid_t *grid, vec3_t mins, vec3_t maxs)
 {
-	areanode_t	*anode;
-	vec3_t		size;
-	vec3_t		mins1, maxs1, mins2, maxs2;
+	int		level, cell;
+	float	size;
 
-	anode = &sv_areanodes[sv_numareanodes];
-	sv_numareanodes++;
+	memset (grid, 0xff, sizeof(*grid));		// all lists and links -1
 
-	ClearLink (&anode->trigger_edicts);
-	ClearLink (&anode->solid_edicts);
-	
-	if (depth == AREA_DEPTH)
+	size = maxs[0] - mins[0];
+	if (maxs[1] - mins[1] > size)
+		size = maxs[1] - mins[1];
+	grid->origin[0] = mins[0];
+	grid->origin[1] = mins[1];
+
+	cell = 0;
+	for (level=0 ; level<AREA_LEVELS ; level++)
 	{
-		anode->axis = -1;
-		anode->children[0] = anode->children[1] = NULL;
-		return anode;
+		grid->side[level] = AREA_SIDE >> (level*AREA_LEVELSHIFT);
+		grid->cellsize[level] = AREA_CELLSIZE << (level*AREA_LEVELSHIFT);
+		if (grid->cellsize[level] * grid->side[level] < size)
+			grid->cellsize[level] = ceil (size / grid->side[level]);
+		grid->scale[level] = 1.0 / grid->cellsize[level];
+		grid->firstcell[level] = cell;
+		grid->levelcount[level] = 0;
+		cell += grid->side[level] * grid->side[level];
 	}
-	
-	VectorSubtract (maxs, mins, size);
-	if (size[0] > size[1])
-		anode->axis = 0;
+}
+
+/*
+===============
+SV_AreaUnlink
+===============
+*/
+static void SV_AreaUnlink (areagrid_t *grid, int e)
+{
+	arealink_t	*l;
+
+	l = &grid->links[e];
+	if (l->cell == -1)
+		return;		// not linked in anywhere
+
+	if (l->prev != -1)
+		grid->links[l->prev].next = l->next;
 	else
-		anode->axis = 1;
-	
-	anode->dist = 0.5 * (maxs[anode->axis] + mins[anode->axis]);
-	VectorCopy (mins, mins1);	
-	VectorCopy (mins, mins2);	
-	VectorCopy (maxs, maxs1);	
-	VectorCopy (maxs, maxs2);	
-	
-	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
-	
-	anode->children[0] = SV_CreateAreaNode (depth+1, mins2, maxs2);
-	anode->children[1] = SV_CreateAreaNode (depth+1, mins1, maxs1);
+		grid->cells[l->cell].first[l->type-1] = l->next;
+	if (l->next != -1)
+		grid->links[l->next].prev = l->prev;
+	if (l->level < AREA_LEVELS)
+		grid->levelcount[l->level]--;
+	l->cell = -1;
+}
+
+/*
+===============
+SV_AreaLink
+
+Returns true if e was already linked in the same cell, when only its
+box needs to change
+===============
+*/
+static qboolean SV_AreaLink (areagrid_t *grid, int e, vec3_t absmin, vec3_t absmax, int type)
+{
+	arealink_t	*l;
+	areacell_t	*c;
+	float	size;
+	int		level, x, y, cell;
+
+	size = absmax[0] - absmin[0];
+	if (absmax[1] - absmin[1] > size)
+		size = absmax[1] - absmin[1];
+
+	for (level=0 ; level<AREA_LEVELS ; level++)
+		if (size <= grid->cellsize[level])
+			break;
+	cell = AREA_HUGE;
+	if (level < AREA_LEVELS)
+	{
+		x = (int)floor (((absmin[0]+absmax[0])*0.5 - grid->origin[0]) / grid->cellsize[level]);
+		y = (int)floor (((absmin[1]+absmax[1])*0.5 - grid->origin[1]) / grid->cellsize[level]);
+		if (x < 0 || y < 0 || x >= grid->side[level] || y >= grid->side[level])
+			level = AREA_LEVELS;		// off the world
+		else
+			cell = grid->firstcell[level] + y*grid->side[level] + x;
+	}
+
+	l = &grid->links[e];
+	if (l->cell == cell && l->type == type)
+	{
+		VectorCopy (absmin, l->absmin);
+		VectorCopy (absmax, l->absmax);
+		return true;
+	}
+
+	SV_AreaUnlink (grid, e);
+
+	if (level < AREA_LEVELS)
+		grid->levelcount[level]++;
+	l->cell = cell;
+	l->level = level;
+	l->type = type;
+	VectorCopy (absmin, l->absmin);
+	VectorCopy (absmax, l->absmax);
+
+	c = &grid->cells[l->cell];
+	l->prev = -1;
+	l->next = c->first[type-1];
+	if (l->next != -1)
+		grid->links[l->next].prev = e;
+	c->first[type-1] = e;
+	return false;
+}
+
+/*
+===============
+SV_AreaCellEdicts
+
+Sets the bits of the cell's entities whose boxes touch mins/maxs
+===============
+*/
+static void SV_AreaCellEdicts (areagrid_t *grid, areacell_t *c, vec3_t mins, vec3_t maxs, unsigned *found, int type)
+{
+	int			e;
+	arealink_t	*l;
+
+	for (e = c->first[type-1] ; e != -1 ; e = l->next)
+	{
+		l = &grid->links[e];
+		if (mins[0] > l->absmax[0]
+		|| mins[1] > l->absmax[1]
+		|| mins[2] > l->absmax[2]
+		|| maxs[0] < l->absmin[0]
+		|| maxs[1] < l->absmin[1]
+		|| maxs[2] < l->absmin[2] )
+			continue;
+		found[e>>5] |= 1u<<(e&31);
+	}
+}
+
+/*
+===============
+SV_AreaRange
+
+The cells along one axis a query from lo to hi has to look at.  The half
+cell is widened a unit so rounding can't lose a cell at the edge.
+===============
+*/
+static qboolean SV_AreaRange (areagrid_t *grid, int level, int axis, float lo, float hi, int *first, int *last)
+{
+	float	half;
+
+	half = grid->cellsize[level] * 0.5 + 1;
+	*first = (int)((lo - half - grid->origin[axis]) * grid->scale[level]);
+	*last = (int)((hi + half - grid->origin[axis]) * grid->scale[level]);
+	if (*last < 0 || *first >= grid->side[level])
+		return false;
+	if (*first < 0)
+		*first = 0;
+	if (*last >= grid->side[level])
+		*last = grid->side[level] - 1;
+	return true;
+}
+
+/*
+===============
+SV_AreaQuery
+
+Entity numbers of the links of the type whose boxes touch mins/maxs, in
+order, collected as bits on the way
+===============
+*/
+static int SV_AreaQuery (areagrid_t *grid, vec3_t mins, vec3_t maxs, short *list, int type)
+{
+	unsigned	found[MAX_EDICTS/32], bits;
+	int		level, count, b, e;
+	int		x, y, x0, y0, x1, y1;
+	areacell_t	*row;
+
+	memset (found, 0, sizeof(found));
+	SV_AreaCellEdicts (grid, &grid->cells[AREA_HUGE], mins, maxs, found, type);
+
+	for (level=0 ; level<AREA_LEVELS ; level++)
+	{
+		if (!grid->levelcount[level])
+			continue;
+		if (!SV_AreaRange (grid, level, 0, mins[0], maxs[0], &x0, &x1)
+			|| !SV_AreaRange (grid, level, 1, mins[1], maxs[1], &y0, &y1))
+			continue;
+
+		row = grid->cells + grid->firstcell[level] + y0*grid->side[level];
+		for (y=y0 ; y<=y1 ; y++, row += grid->side[level])
+			for (x=x0 ; x<=x1 ; x++)
+				if (row[x].first[type-1] != -1)
+					SV_AreaCellEdicts (grid, &row[x], mins, maxs, found, type);
+	}
+
+	count = 0;
+	for (b=0 ; b<MAX_EDICTS/32 ; b++)
+		for (bits = found[b], e = b<<5 ; bits ; bits >>= 1, e++)
+			if (bits & 1)
+				list[count++] = e;
+	return count;
+}
+
+/*
+===============
+SV_AreaType
+===============
+*/
+int SV_AreaType (edict_t *ent)
+{
+	arealink_t	*l;
+
+	l = &sv_area.links[NUM_FOR_EDICT(ent)];
+	if (l->cell == -1)
+		return 0;
+	return l->type;
+}
+
+/*
+===============
+SV_AreaEdicts
+===============
+*/
+int SV_AreaEdicts (vec3_t mins, vec3_t maxs, edict_t **list, int maxcount, int areatype)
+{
+	short	nums[MAX_EDICTS];
+	int		i, count;
+
+	count = SV_AreaQuery (&sv_area, mins, maxs, nums, areatype);
+	if (count > maxcount)
+		count = maxcount;
+	for (i=0 ; i<count ; i++)
+		list[i] = EDICT_NUM(nums[i]);
+	return count;
+}
+
+/*
+===============================================================================
+
+LEAF ENTITY LISTS
+
+Each leaf keeps a list of the entities that have it in their leafnums, so
+the entities visible from a pvs can be found from its set bits instead of
+testing every edict against it.  Entity e's link for its leafnums[i] is
+leaflinks[e*MAX_ENT_LEAFS + i].
+
+===============================================================================
+*/
+
+typedef struct
+{
+	short	prev, next;		// -1 ends the list
+} leaflink_t;
+
+static leaflink_t	leaflinks[MAX_EDICTS*MAX_ENT_LEAFS];
+static short		leafents[MAX_MAP_LEAFS];	// first link in each leaf, -1 if none
+static byte			leafentcount[MAX_EDICTS];	// leafnums currently linked
+
+/*
+The last SV_FindTouchedLeafs of an entity records what its box had to
+be for each node on the way down to take the same branches.  Axial
+planes narrow an interval for each side of the box, other planes are
+kept to test again.  While the box stays inside all of them the descent
+would find the same leafs, so a relink can keep the ones it has.
+*/
+#define	LEAF_CACHE_PLANES	16
+
+typedef struct
+{
+	qboolean	valid;			// leafnums came from the recorded descent
+	qboolean	overflow;		// too many other planes to keep
+	float		minlo[3], minhi[3];	// minlo <= absmin < minhi
+	float		maxlo[3], maxhi[3];	// maxlo < absmax <= maxhi
+	int			numplanes;
+	mplane_t	*planes[LEAF_CACHE_PLANES];
+	byte		sides[LEAF_CACHE_PLANES];
+} leafcache_t;
+
+static leafcache_t	leafcache[MAX_EDICTS];
+
+linkstats_t		sv_linkstats;
+
+/*
+===============
+SV_UnlinkLeafs
+
+leafnums must still hold the leafs that were linked
+===============
+*/
+static void SV_UnlinkLeafs (edict_t *ent)
+{
+	int			i, e, l;
+	leaflink_t	*link;
+
+	e = NUM_FOR_EDICT(ent);
+	for (i=0 ; i<leafentcount[e] ; i++)
+	{
+		l = e*MAX_ENT_LEAFS + i;
+		link = &leaflinks[l];
+		if (link->prev == -1)
+			leafents[ent->leafnums[i]] = link->next;
+		else
+			leaflinks[link->prev].next = link->next;
+		if (link->next != -1)
+			leaflinks[link->next].prev = link->prev;
+	}
+	leafentcount[e] = 0;
+}
+
+/*
+===============
+SV_LinkLeafs
+===============
+*/
+static void SV_LinkLeafs (edict_t *ent)
+{
+	int			i, e, l;
+	leaflink_t	*link;
+
+	e = NUM_FOR_EDICT(ent);
+	for (i=0 ; i<ent->num_leafs ; i++)
+	{
+		l = e*MAX_ENT_LEAFS + i;
+		link = &leaflinks[l];
+		link->prev = -1;
+		link->next = leafents[ent->leafnums[i]];
+		if (link->next != -1)
+			leaflinks[link->next].prev = l;
+		leafents[ent->leafnums[i]] = l;
+	}
+	leafentcount[e] = ent->num_leafs;
+}
+
+/*
+===============
+SV_VisibleEntities
+
+visents must hold MAX_EDICTS bits.  Entities are marked whatever their
+model, the caller still has to check it.
+===============
+*/
+void SV_VisibleEntities (byte *pvs, byte *visents)
+{
+	int		i, b, leaf, l, e;
+	int		numbytes;
+
+	memset (visents, 0, MAX_EDICTS/8);
+
+	numbytes = (sv.worldmodel->numleafs+7)>>3;
+	for (i=0 ; i<numbytes ; i++)
+	{
+		if (!pvs[i])
+			continue;
+		for (b=0 ; b<8 ; b++)
+		{
+			if (!(pvs[i] & (1<<b)))
+				continue;
+			leaf = (i<<3) + b;
+			for (l = leafents[leaf] ; l != -1 ; l = leaflinks[l].next)
+			{
+				e = l / MAX_ENT_LEAFS;
+				visents[e>>3] |= 1<<(e&7);
+			}
+		}
+	}
+}
+
+/*
+===============
+SV_SolidLinked
+
+Called on either side of a relink, so the players that gathered their
+pmove physents from a box the solid entity reaches gather them again
+===============
+*/
+static void SV_SolidLinked (edict_t *ent)
+{
+	int			e, i;
+	arealink_t	*l;
+	client_t	*cl;
+
+	e = NUM_FOR_EDICT(ent);
+	l = &sv_area.links[e];
+	if (e <= MAX_CLIENTS || l->cell == -1 || l->type != AREA_SOLID)
+		return;
 
-	return anode;
+	for (i=0, cl=svs.clients ; i<MAX_CLIENTS ; i++, cl++)
+	{
+		if (!cl->physvalid
+			|| l->absmin[0] > cl->physmaxs[0]
+			|| l->absmin[1] > cl->physmaxs[1]
+			|| l->absmin[2] > cl->physmaxs[2]
+			|| l->absmax[0] < cl->physmins[0]
+			|| l->absmax[1] < cl->physmins[1]
+			|| l->absmax[2] < cl->physmins[2])
+			continue;
+		cl->physvalid = false;
+	}
 }
 
 /*
@@ -235,11 +566,18 @@ SV_ClearWorld
 */
 void SV_ClearWorld (void)
 {
-	SV_InitBoxHull ();
+	int		i;
+
+	SV_StopTraceRecord ();
+	for (i=0 ; i<MAX_CLIENTS ; i++)
+		svs.clients[i].physvalid = false;
+	CM_InitBoxHull (&sv_box);
 	
-	memset (sv_areanodes, 0, sizeof(sv_areanodes));
-	sv_numareanodes = 0;
-	SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
+	SV_ClearArea (&sv_area, sv.worldmodel->mins, sv.worldmodel->maxs);
+
+	memset (leafents, 0xff, sizeof(leafents));
+	memset (leafentcount, 0, sizeof(leafentcount));
+	memset (leafcache, 0, sizeof(leafcache));
 }
 
 
@@ -251,32 +589,37 @@ SV_UnlinkEdict
 */
 void SV_UnlinkEdict (edict_t *ent)
 {
-	if (!ent->area.prev)
-		return;		// not linked in anywhere
-	RemoveLink (&ent->area);
-	ent->area.prev = ent->area.next = NULL;
+	SV_UnlinkLeafs (ent);
+	leafcache[NUM_FOR_EDICT(ent)].valid = false;
+	SV_SolidLinked (ent);
+	SV_AreaUnlink (&sv_area, NUM_FOR_EDICT(ent));
 }
 
 
 /*
 ====================
 SV_TouchLinks
+
+The triggers are listed before any are touched, as a touch function
+may link or remove entities.  The boxes are tested again before each
+touch, since an earlier one may have moved ent or the trigger.
 ====================
 */
-void SV_TouchLinks ( edict_t *ent, areanode_t *node )
+void SV_TouchLinks (edict_t *ent)
 {
-	link_t		*l, *next;
-	edict_t		*touch;
+	edict_t		*touchlist[MAX_EDICTS], *touch;
+	int			i, num;
 	int			old_self, old_other;
 
+	num = SV_AreaEdicts (ent->v.absmin, ent->v.absmax, touchlist, MAX_EDICTS, AREA_TRIGGERS);
+
 // touch linked edicts
-	for (l = node->trigger_edicts.next ; l != &node->trigger_edicts ; l = next)
+	for (i=0 ; i<num ; i++)
 	{
-		next = l->next;
-		touch = EDICT_FROM_AREA(l);
+		touch = touchlist[i];
 		if (touch == ent)
 			continue;
-		if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
+		if (touch->free || !touch->v.touch || touch->v.solid != SOLID_TRIGGER)
 			continue;
 		if (ent->v.absmin[0] > touch->v.absmax[0]
 		|| ent->v.absmin[1] > touch->v.absmax[1]
@@ -297,15 +640,6 @@ void SV_TouchLinks ( edict_t *ent, areanode_t *node )
 		pr_global_struct->self = old_self;
 		pr_global_struct->other = old_other;
 	}
-	
-// recurse down both sides
-	if (node->axis == -1)
-		return;
-	
-	if ( ent->v.absmax[node->axis] > node->dist )
-		SV_TouchLinks ( ent, node->children[0] );
-	if ( ent->v.absmin[node->axis] < node->dist )
-		SV_TouchLinks ( ent, node->children[1] );
 }
 
 
@@ -315,12 +649,14 @@ SV_FindTouchedLeafs
 
 ===============
 */
-void SV_FindTouchedLeafs (edict_t *ent, mnode_t *node)
+static void SV_FindTouchedLeafs (edict_t *ent, mnode_t *node, leafcache_t *c)
 {
 	mplane_t	*splitplane;
 	mleaf_t		*leaf;
 	int			sides;
 	int			leafnum;
+	int			a;
+	float		d;
 
 	if (node->contents == CONTENTS_SOLID)
 		return;
@@ -344,13 +680,72 @@ void SV_FindTouchedLeafs (edict_t *ent, mnode_t *node)
 
 	splitplane = node->plane;
 	sides = BOX_ON_PLANE_SIDE(ent->v.absmin, ent->v.absmax, splitplane);
+
+// remember what kept the box on these sides
+	if (splitplane->type < 3)
+	{
+		a = splitplane->type;
+		d = splitplane->dist;
+		if (sides == 1)
+		{
+			if (d > c->minlo[a])
+				c->minlo[a] = d;
+		}
+		else
+		{
+			if (d < c->minhi[a])
+				c->minhi[a] = d;
+			if (sides == 2)
+			{
+				if (d < c->maxhi[a])
+					c->maxhi[a] = d;
+			}
+			else if (d > c->maxlo[a])
+				c->maxlo[a] = d;
+		}
+	}
+	else if (c->numplanes < LEAF_CACHE_PLANES)
+	{
+		c->planes[c->numplanes] = splitplane;
+		c->sides[c->numplanes] = sides;
+		c->numplanes++;
+	}
+	else
+		c->overflow = true;
 	
 // recurse down the contacted sides
 	if (sides & 1)
-		SV_FindTouchedLeafs (ent, node->children[0]);
+		SV_FindTouchedLeafs (ent, node->children[0], c);
 		
 	if (sides & 2)
-		SV_FindTouchedLeafs (ent, node->children[1]);
+		SV_FindTouchedLeafs (ent, node->children[1], c);
+}
+
+/*
+===============
+SV_LeafsUnchanged
+
+True if a descent with the current box would find the leafs from the
+last one again
+===============
+*/
+static qboolean SV_LeafsUnchanged (edict_t *ent, leafcache_t *c)
+{
+	int		i;
+
+	if (!c->valid || c->overflow)
+		return false;
+
+	for (i=0 ; i<3 ; i++)
+		if (ent->v.absmin[i] < c->minlo[i] || ent->v.absmin[i] >= c->minhi[i]
+			|| ent->v.absmax[i] <= c->maxlo[i] || ent->v.absmax[i] > c->maxhi[i])
+			return false;
+
+	for (i=0 ; i<c->numplanes ; i++)
+		if (BoxOnPlaneSide (ent->v.absmin, ent->v.absmax, c->planes[i]) != c->sides[i])
+			return false;
+
+	return true;
 }
 
 /*
@@ -361,16 +756,17 @@ SV_LinkEdict
 */
 void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 {
-	areanode_t	*node;
-	
-	if (ent->area.prev)
-		SV_UnlinkEdict (ent);	// unlink from old position
-		
-	if (ent == sv.edicts)
-		return;		// don't add the world
+	int			i, e;
+	leafcache_t	*c;
 
-	if (ent->free)
-		return;
+	e = NUM_FOR_EDICT(ent);
+	SV_SolidLinked (ent);
+
+	if (ent == sv.edicts || ent->free)
+	{	// don't add the world
+		SV_AreaUnlink (&sv_area, e);
+		return;
+	}
 
 // set the abs box
 	VectorAdd (ent->v.origin, ent->v.mins, ent->v.absmin);	
@@ -399,37 +795,47 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 	}
 	
 // link to PVS leafs
-	ent->num_leafs = 0;
-	if (ent->v.modelindex)
-		SV_FindTouchedLeafs (ent, sv.worldmodel->nodes);
+	sv_linkstats.links++;
+	c = &leafcache[e];
+	if (!ent->v.modelindex)
+	{
+		SV_UnlinkLeafs (ent);
+		ent->num_leafs = 0;
+		c->valid = false;
+	}
+	else if (SV_LeafsUnchanged (ent, c))
+		sv_linkstats.leafskips++;
+	else
+	{
+		SV_UnlinkLeafs (ent);
+		ent->num_leafs = 0;
+		c->overflow = false;
+		c->numplanes = 0;
+		for (i=0 ; i<3 ; i++)
+		{
+			c->minlo[i] = c->maxlo[i] = -999999;
+			c->minhi[i] = c->maxhi[i] = 999999;
+		}
+		SV_FindTouchedLeafs (ent, sv.worldmodel->nodes, c);
+		SV_LinkLeafs (ent);
+		c->valid = true;
+	}
 
 	if (ent->v.solid == SOLID_NOT)
-		return;
-
-// find the first node that the ent's box crosses
-	node = sv_areanodes;
-	while (1)
 	{
-		if (node->axis == -1)
-			break;
-		if (ent->v.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if (ent->v.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break;		// crosses the node
+		SV_AreaUnlink (&sv_area, e);
+		return;
 	}
-	
-// link it in	
 
-	if (ent->v.solid == SOLID_TRIGGER)
-		InsertLinkBefore (&ent->area, &node->trigger_edicts);
-	else
-		InsertLinkBefore (&ent->area, &node->solid_edicts);
+// link it in, just moving the box if it stays in its cell
+	if (SV_AreaLink (&sv_area, e, ent->v.absmin, ent->v.absmax,
+		ent->v.solid == SOLID_TRIGGER ? AREA_TRIGGERS : AREA_SOLID))
+		sv_linkstats.areaskips++;
+	SV_SolidLinked (ent);
 	
-// if touch_triggers, touch all entities at this node and decend for more
+// if touch_triggers, touch all the triggers the box reaches
 	if (touch_triggers)
-		SV_TouchLinks ( ent, sv_areanodes );
+		SV_TouchLinks (ent);
 }
 
 
@@ -442,44 +848,6 @@ POINT TESTING IN HULLS
 ===============================================================================
 */
 
-#if	!id386
-
-/*
-==================
-SV_HullPointContents
-
-==================
-*/
-int SV_HullPointContents (hull_t *hull, int num, vec3_t p)
-{
-	float		d;
-	dclipnode_t	*node;
-	mplane_t	*plane;
-
-	while (num >= 0)
-	{
-		if (num < hull->firstclipnode || num > hull->lastclipnode)
-			SV_Error ("SV_HullPointContents: bad node number");
-	
-		node = hull->clipnodes + num;
-		plane = hull->planes + node->planenum;
-		
-		if (plane->type < 3)
-			d = p[plane->type] - plane->dist;
-		else
-			d = DotProduct (plane->normal, p) - plane->dist;
-		if (d < 0)
-			num = node->children[1];
-		else
-			num = node->children[0];
-	}
-	
-	return num;
-}
-
-#endif	// !id386
-
-
 /*
 ==================
 SV_PointContents
@@ -488,7 +856,7 @@ SV_PointContents
 */
 int SV_PointContents (vec3_t p)
 {
-	return SV_HullPointContents (&sv.worldmodel->hulls[0], 0, p);
+	return CM_HullPointContents (&sv.worldmodel->hulls[0], 0, p);
 }
 
 //===========================================================================
@@ -513,156 +881,6 @@ edict_t	*SV_TestEntityPosition (edict_t *ent)
 	return NULL;
 }
 
-/*
-===============================================================================
-
-LINE TESTING IN HULLS
-
-===============================================================================
-*/
-
-// 1/32 epsilon to keep floating point happy
-#define	DIST_EPSILON	(0.03125)
-
-/*
-==================
-SV_RecursiveHullCheck
-
-==================
-*/
-qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace)
-{
-	dclipnode_t	*node;
-	mplane_t	*plane;
-	float		t1, t2;
-	float		frac;
-	int			i;
-	vec3_t		mid;
-	int			side;
-	float		midf;
-
-// check for empty
-	if (num < 0)
-	{
-		if (num != CONTENTS_SOLID)
-		{
-			trace->allsolid = false;
-			if (num == CONTENTS_EMPTY)
-				trace->inopen = true;
-			else
-				trace->inwater = true;
-		}
-		else
-			trace->startsolid = true;
-		return true;		// empty
-	}
-
-	if (num < hull->firstclipnode || num > hull->lastclipnode)
-		SV_Error ("SV_RecursiveHullCheck: bad node number");
-
-//
-// find the point distances
-//
-	node = hull->clipnodes + num;
-	plane = hull->planes + node->planenum;
-
-	if (plane->type < 3)
-	{
-		t1 = p1[plane->type] - plane->dist;
-		t2 = p2[plane->type] - plane->dist;
-	}
-	else
-	{
-		t1 = DotProduct (plane->normal, p1) - plane->dist;
-		t2 = DotProduct (plane->normal, p2) - plane->dist;
-	}
-	
-#if 1
-	if (t1 >= 0 && t2 >= 0)
-		return SV_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if (t1 < 0 && t2 < 0)
-		return SV_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
-#else
-	if ( (t1 >= DIST_EPSILON && t2 >= DIST_EPSILON) || (t2 > t1 && t1 >= 0) )
-		return SV_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if ( (t1 <= -DIST_EPSILON && t2 <= -DIST_EPSILON) || (t2 < t1 && t1 <= 0) )
-		return SV_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
-#endif
-
-// put the crosspoint DIST_EPSILON pixels on the near side
-	if (t1 < 0)
-		frac = (t1 + DIST_EPSILON)/(t1-t2);
-	else
-		frac = (t1 - DIST_EPSILON)/(t1-t2);
-	if (frac < 0)
-		frac = 0;
-	if (frac > 1)
-		frac = 1;
-		
-	midf = p1f + (p2f - p1f)*frac;
-	for (i=0 ; i<3 ; i++)
-		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
-
-	side = (t1 < 0);
-
-// move up to the node
-	if (!SV_RecursiveHullCheck (hull, node->children[side], p1f, midf, p1, mid, trace) )
-		return false;
-
-#ifdef PARANOID
-	if (SV_HullPointContents (sv_hullmodel, mid, node->children[side])
-	== CONTENTS_SOLID)
-	{
-		Con_Printf ("mid PointInHullSolid\n");
-		return false;
-	}
-#endif
-	
-	if (SV_HullPointContents (hull, node->children[side^1], mid)
-	!= CONTENTS_SOLID)
-// go past the node
-		return SV_RecursiveHullCheck (hull, node->children[side^1], midf, p2f, mid, p2, trace);
-	
-	if (trace->allsolid)
-		return false;		// never got out of the solid area
-		
-//==================
-// the other side of the node is solid, this is the impact point
-//==================
-	if (!side)
-	{
-		VectorCopy (plane->normal, trace->plane.normal);
-		trace->plane.dist = plane->dist;
-	}
-	else
-	{
-		VectorSubtract (vec3_origin, plane->normal, trace->plane.normal);
-		trace->plane.dist = -plane->dist;
-	}
-
-	while (SV_HullPointContents (hull, hull->firstclipnode, mid)
-	== CONTENTS_SOLID)
-	{ // shouldn't really happen, but does occasionally
-		frac -= 0.1;
-		if (frac < 0)
-		{
-			trace->fraction = midf;
-			VectorCopy (mid, trace->endpos);
-			Con_Printf ("backup past 0\n");
-			return false;
-		}
-		midf = p1f + (p2f - p1f)*frac;
-		for (i=0 ; i<3 ; i++)
-			mid[i] = p1[i] + frac*(p2[i] - p1[i]);
-	}
-
-	trace->fraction = midf;
-	VectorCopy (mid, trace->endpos);
-
-	return false;
-}
-
-
 /*
 ==================
 SV_ClipMoveToEntity
@@ -674,16 +892,11 @@ eventually rotation) of the end points
 trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
 {
 	trace_t		trace;
+	hulltrace_t	hit;
 	vec3_t		offset;
 	vec3_t		start_l, end_l;
 	hull_t		*hull;
 
-// fill in a default trace
-	memset (&trace, 0, sizeof(trace_t));
-	trace.fraction = 1;
-	trace.allsolid = true;
-	VectorCopy (end, trace.endpos);
-
 // get the clipping hull
 	hull = SV_HullForEntity (ent, mins, maxs, offset);
 
@@ -691,11 +904,25 @@ trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t max
 	VectorSubtract (end, offset, end_l);
 
 // trace a line through the apropriate clipping hull
-	SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start_l, end_l, &trace);
+	CM_HullTrace (hull, start_l, end_l, &hit);
+
+	trace.allsolid = hit.allsolid;
+	trace.startsolid = hit.startsolid;
+	trace.inopen = hit.inopen;
+	trace.inwater = hit.inwater;
+	trace.fraction = hit.fraction;
+	trace.plane = hit.plane;
+	trace.ent = NULL;
 
 // fix trace up by the offset
 	if (trace.fraction != 1)
-		VectorAdd (trace.endpos, offset, trace.endpos);
+	{
+		VectorAdd (hit.endpos, offset, trace.endpos);
+	}
+	else
+	{
+		VectorCopy (end, trace.endpos);
+	}
 
 // did we clip the move?
 	if (trace.fraction < 1 || trace.startsolid  )
@@ -713,17 +940,18 @@ SV_ClipToLinks
 Mins and maxs enclose the entire area swept by the move
 ====================
 */
-void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
+void SV_ClipToLinks (moveclip_t *clip)
 {
-	link_t		*l, *next;
-	edict_t		*touch;
+	edict_t		*touchlist[MAX_EDICTS], *touch;
+	int			i, num;
 	trace_t		trace;
 
+	num = SV_AreaEdicts (clip->boxmins, clip->boxmaxs, touchlist, MAX_EDICTS, AREA_SOLID);
+
 // touch linked edicts
-	for (l = node->solid_edicts.next ; l != &node->solid_edicts ; l = next)
+	for (i=0 ; i<num ; i++)
 	{
-		next = l->next;
-		touch = EDICT_FROM_AREA(l);
+		touch = touchlist[i];
 		if (touch->v.solid == SOLID_NOT)
 			continue;
 		if (touch == clip->passedict)
@@ -734,14 +962,6 @@ void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
 		if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
 			continue;
 
-		if (clip->boxmins[0] > touch->v.absmax[0]
-		|| clip->boxmins[1] > touch->v.absmax[1]
-		|| clip->boxmins[2] > touch->v.absmax[2]
-		|| clip->boxmaxs[0] < touch->v.absmin[0]
-		|| clip->boxmaxs[1] < touch->v.absmin[1]
-		|| clip->boxmaxs[2] < touch->v.absmin[2] )
-			continue;
-
 		if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
 			continue;	// points never interact
 
@@ -775,15 +995,6 @@ void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
 		else if (trace.startsolid)
 			clip->trace.startsolid = true;
 	}
-	
-// recurse down both sides
-	if (node->axis == -1)
-		return;
-
-	if ( clip->boxmaxs[node->axis] > node->dist )
-		SV_ClipToLinks ( node->children[0], clip );
-	if ( clip->boxmins[node->axis] < node->dist )
-		SV_ClipToLinks ( node->children[1], clip );
 }
 
 
@@ -857,7 +1068,7 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 	SV_MoveBounds ( start, clip.mins2, clip.maxs2, end, clip.boxmins, clip.boxmaxs );
 
 // clip to entities
-	SV_ClipToLinks ( sv_areanodes, &clip );
+	SV_ClipToLinks (&clip);
 
 	return clip.trace;
 }
@@ -880,7 +1091,7 @@ edict_t	*SV_TestPlayerPosition (edict_t *ent, vec3_t origin)
 	
 // check world first
 	hull = &sv.worldmodel->hulls[1];
-	if ( SV_HullPointContents (hull, hull->firstclipnode, origin) != CONTENTS_EMPTY )
+	if ( CM_HullPointContents (hull, hull->firstclipnode, origin) != CONTENTS_EMPTY )
 		return sv.edicts;
 
 // check all entities
@@ -914,7 +1125,7 @@ edict_t	*SV_TestPlayerPosition (edict_t *ent, vec3_t origin)
 		VectorSubtract (origin, offset, offset);
 	
 	// test the point
-		if ( SV_HullPointContents (hull, hull->firstclipnode, offset) != CONTENTS_EMPTY )
+		if ( CM_HullPointContents (hull, hull->firstclipnode, offset) != CONTENTS_EMPTY )
 			return check;
 	}
 
@@ -922,3 +1133,692 @@ edict_t	*SV_TestPlayerPosition (edict_t *ent, vec3_t origin)
 }
 
 
+
+/*
+===============================================================================
+
+TRACE BENCHMARK
+
+===============================================================================
+*/
+
+static	FILE	*sv_tracefile;		// "tracebench record" output
+
+/*
+==================
+SV_BenchFileName
+
+Puts the path of a bench file under the game directory in name, which
+is MAX_OSPATH long.  Returns false for names that would leave it or
+don't fit.
+==================
+*/
+static qboolean SV_BenchFileName (char *name, char *file)
+{
+	int		len;
+
+	if (strstr (file, "..") || file[0] == '/')
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return false;
+	}
+	len = snprintf (name, MAX_OSPATH, "%s/%s", com_gamedir, file);
+	if (len < 0 || len >= MAX_OSPATH)
+	{
+		Con_Printf ("File name too long.\n");
+		return false;
+	}
+	return true;
+}
+
+/*
+==================
+SV_StopTraceRecord
+==================
+*/
+static void SV_StopTraceRecord (void)
+{
+	if (!sv_tracefile)
+		return;
+	CM_RecordTraces (NULL, NULL);
+	fclose (sv_tracefile);
+	sv_tracefile = NULL;
+	Con_Printf ("Stopped recording traces.\n");
+}
+
+/*
+==================
+SV_ReadTraces
+
+Loads a "tracebench record" file, growing the arrays as it goes
+==================
+*/
+static int SV_ReadTraces (char *name, int **hullnum, vec3_t **start, vec3_t **end)
+{
+	FILE	*f;
+	int		n, max, h;
+	vec3_t	s, e;
+	void	*p1, *p2, *p3;
+
+	f = fopen (name, "r");
+	if (!f)
+	{
+		Con_Printf ("Couldn't open %s\n", name);
+		return 0;
+	}
+	*hullnum = NULL;
+	*start = *end = NULL;
+	n = max = 0;
+	while (fscanf (f, "%i %f %f %f %f %f %f", &h, &s[0], &s[1], &s[2],
+		&e[0], &e[1], &e[2]) == 7)
+	{
+		if (h < 0 || h >= MAX_MAP_HULLS)
+			continue;
+		if (n == max)
+		{
+			max = max ? max*2 : 4096;
+			p1 = realloc (*hullnum, max * sizeof(**hullnum));
+			p2 = realloc (*start, max * sizeof(**start));
+			p3 = realloc (*end, max * sizeof(**end));
+			if (p1)
+				*hullnum = p1;
+			if (p2)
+				*start = p2;
+			if (p3)
+				*end = p3;
+			if (!p1 || !p2 || !p3)
+			{
+				Con_Printf ("tracebench: out of memory, using the first %i traces\n", n);
+				break;
+			}
+		}
+		(*hullnum)[n] = h;
+		VectorCopy (s, (*start)[n]);
+		VectorCopy (e, (*end)[n]);
+		n++;
+	}
+	fclose (f);
+	return n;
+}
+
+/*
+==================
+SV_BenchHull
+
+Runs count lines through one hull with CM_RecursiveHullCheck,
+CM_HullCheck and CM_HullTraceBatch, and checks the three agree to the bit
+==================
+*/
+static void SV_BenchHull (int h, int count, vec3_t *start, vec3_t *end,
+	hulltrace_t *ref, hulltrace_t *tr, hulltrace_t *batch)
+{
+	int			n, differ;
+	hull_t		*hull;
+	double		t, rtime, itime, btime;
+
+	hull = &sv.worldmodel->hulls[h];
+
+	t = Sys_DoubleTime ();
+	for (n=0 ; n<count ; n++)
+	{
+		memset (&ref[n], 0, sizeof(hulltrace_t));
+		ref[n].fraction = 1;
+		ref[n].allsolid = true;
+		VectorCopy (end[n], ref[n].endpos);
+		CM_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start[n], end[n], &ref[n]);
+	}
+	rtime = Sys_DoubleTime () - t;
+
+	t = Sys_DoubleTime ();
+	for (n=0 ; n<count ; n++)
+	{
+		memset (&tr[n], 0, sizeof(hulltrace_t));
+		tr[n].fraction = 1;
+		tr[n].allsolid = true;
+		VectorCopy (end[n], tr[n].endpos);
+		CM_HullCheck (hull, hull->firstclipnode, 0, 1, start[n], end[n], &tr[n]);
+	}
+	itime = Sys_DoubleTime () - t;
+
+	t = Sys_DoubleTime ();
+	CM_HullTraceBatch (hull, count, start, end, batch);
+	btime = Sys_DoubleTime () - t;
+
+	differ = 0;
+	for (n=0 ; n<count ; n++)
+		if (memcmp (&ref[n], &tr[n], sizeof(hulltrace_t))
+			|| memcmp (&ref[n], &batch[n], sizeof(hulltrace_t)))
+			differ++;
+
+	Con_Printf ("hull %i: %7i traces, recursive %6.1f ns, iterative %6.1f ns, batch %6.1f ns a trace, %i differ\n",
+		h, count, rtime*1e9/count, itime*1e9/count, btime*1e9/count, differ);
+}
+
+/*
+==================
+SV_TraceBench_f
+
+"tracebench record <file>" writes every trace through the world hulls
+that server physics and player movement make until "tracebench stop" or
+the map changes.  "tracebench <file>" replays such a recording through
+the hulls of the running map, "tracebench [count]" random lines.
+==================
+*/
+void SV_TraceBench_f (void)
+{
+	char		name[MAX_OSPATH];
+	int			h, i, n, m, count;
+	unsigned	seed;
+	int			*hullnum;
+	vec3_t		*start, *end, *hstart, *hend, size;
+	hulltrace_t	*ref, *tr, *batch;
+
+	if (!strcmp (Cmd_Argv(1), "stop"))
+	{
+		if (!sv_tracefile)
+			Con_Printf ("Not recording traces.\n");
+		SV_StopTraceRecord ();
+		return;
+	}
+
+	if (sv.state != ss_active)
+	{
+		Con_Printf ("tracebench: no map running\n");
+		return;
+	}
+
+	if (!strcmp (Cmd_Argv(1), "record"))
+	{
+		if (Cmd_Argc() != 3)
+		{
+			Con_Printf ("tracebench record <file>\n");
+			return;
+		}
+		if (!SV_BenchFileName (name, Cmd_Argv(2)))
+			return;
+		SV_StopTraceRecord ();
+		sv_tracefile = fopen (name, "w");
+		if (!sv_tracefile)
+		{
+			Con_Printf ("Couldn't open %s\n", name);
+			return;
+		}
+		CM_RecordTraces (sv_tracefile, sv.worldmodel->hulls);
+		Con_Printf ("Recording traces to %s.\n", name);
+		return;
+	}
+
+	hullnum = NULL;
+	start = end = NULL;
+	if (Cmd_Argc() > 1 && !isdigit(Cmd_Argv(1)[0]))
+	{
+		if (!SV_BenchFileName (name, Cmd_Argv(1)))
+			return;
+		count = SV_ReadTraces (name, &hullnum, &start, &end);
+		if (!count)
+		{
+			Con_Printf ("tracebench: no traces in %s\n", name);
+			free (hullnum);
+			free (start);
+			free (end);
+			return;
+		}
+	}
+	else
+	{
+		count = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 100000;
+		if (count < 1)
+			count = 1;
+		start = malloc (count * sizeof(*start));
+		end = malloc (count * sizeof(*end));
+		if (start && end)
+		{
+			// the same lines every run, most of them short like a move
+			// or a shot, the rest across the whole map
+			seed = 1;
+			VectorSubtract (sv.worldmodel->maxs, sv.worldmodel->mins, size);
+			for (n=0 ; n<count ; n++)
+				for (i=0 ; i<3 ; i++)
+				{
+					seed = seed*1103515245 + 12345;
+					start[n][i] = sv.worldmodel->mins[i] + size[i]*((seed>>8)&0xffff)/65536.0;
+					seed = seed*1103515245 + 12345;
+					if (n & 3)
+						end[n][i] = start[n][i] + (int)((seed>>8)&511) - 256;
+					else
+						end[n][i] = sv.worldmodel->mins[i] + size[i]*((seed>>8)&0xffff)/65536.0;
+				}
+		}
+	}
+
+	hstart = malloc (count * sizeof(*hstart));
+	hend = malloc (count * sizeof(*hend));
+	ref = malloc (count * sizeof(*ref));
+	tr = malloc (count * sizeof(*tr));
+	batch = malloc (count * sizeof(*batch));
+	if (!start || !end || !hstart || !hend || !ref || !tr || !batch)
+		Con_Printf ("tracebench: out of memory\n");
+	else
+	{
+		for (h=0 ; h<MAX_MAP_HULLS ; h++)
+		{
+			if (!sv.worldmodel->hulls[h].clipnodes)
+				continue;
+
+			// a recording is replayed one hull at a time
+			for (n=m=0 ; n<count ; n++)
+			{
+				if (hullnum && hullnum[n] != h)
+					continue;
+				VectorCopy (start[n], hstart[m]);
+				VectorCopy (end[n], hend[m]);
+				m++;
+			}
+			if (m)
+				SV_BenchHull (h, m, hstart, hend, ref, tr, batch);
+		}
+	}
+
+	free (hullnum);
+	free (start);
+	free (end);
+	free (hstart);
+	free (hend);
+	free (ref);
+	free (tr);
+	free (batch);
+}
+
+/*
+===============================================================================
+
+AREA BENCHMARK
+
+===============================================================================
+*/
+
+// where the linked entities were, as recorded by "areabench record"
+typedef struct
+{
+	int		num;
+	short	ent[MAX_EDICTS];
+	short	type[MAX_EDICTS];
+	vec3_t	absmin[MAX_EDICTS], absmax[MAX_EDICTS];
+	vec3_t	mins, maxs;			// of the world
+} areadist_t;
+
+// the fixed depth tree the grid replaced, to compare against
+#define	BENCH_AREA_DEPTH	4
+#define	BENCH_AREA_NODES	32
+
+typedef struct
+{
+	int		axis;				// -1 = leaf node
+	float	dist;
+	int		children[2];
+	short	first[2];			// solid and trigger lists of dist indexes
+} benchnode_t;
+
+typedef struct
+{
+	benchnode_t	nodes[BENCH_AREA_NODES];
+	int			numnodes;
+	short		next[MAX_EDICTS];
+} benchtree_t;
+
+static areadist_t	bench_dist;
+
+/*
+===============
+SV_CompareShort
+===============
+*/
+static int SV_CompareShort (const void *a, const void *b)
+{
+	return *(const short *)a - *(const short *)b;
+}
+
+static benchtree_t	bench_tree;
+static areagrid_t	bench_grid;
+
+/*
+===============
+SV_BenchCreateNode
+===============
+*/
+static int SV_BenchCreateNode (int depth, vec3_t mins, vec3_t maxs)
+{
+	benchnode_t	*anode;
+	vec3_t		size;
+	vec3_t		mins1, maxs1, mins2, maxs2;
+	int			n;
+
+	n = bench_tree.numnodes++;
+	anode = &bench_tree.nodes[n];
+	anode->first[0] = anode->first[1] = -1;
+
+	if (depth == BENCH_AREA_DEPTH)
+	{
+		anode->axis = -1;
+		return n;
+	}
+
+	VectorSubtract (maxs, mins, size);
+	if (size[0] > size[1])
+		anode->axis = 0;
+	else
+		anode->axis = 1;
+
+	anode->dist = 0.5 * (maxs[anode->axis] + mins[anode->axis]);
+	VectorCopy (mins, mins1);
+	VectorCopy (mins, mins2);
+	VectorCopy (maxs, maxs1);
+	VectorCopy (maxs, maxs2);
+
+	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
+
+	anode->children[0] = SV_BenchCreateNode (depth+1, mins2, maxs2);
+	anode->children[1] = SV_BenchCreateNode (depth+1, mins1, maxs1);
+	return n;
+}
+
+/*
+===============
+SV_BenchTreeQuery
+===============
+*/
+static int SV_BenchTreeQuery (int n, vec3_t mins, vec3_t maxs, short *list, int count, int type)
+{
+	benchnode_t	*node;
+	int			i;
+
+	node = &bench_tree.nodes[n];
+	for (i = node->first[type-1] ; i != -1 ; i = bench_tree.next[i])
+	{
+		if (mins[0] > bench_dist.absmax[i][0]
+		|| mins[1] > bench_dist.absmax[i][1]
+		|| mins[2] > bench_dist.absmax[i][2]
+		|| maxs[0] < bench_dist.absmin[i][0]
+		|| maxs[1] < bench_dist.absmin[i][1]
+		|| maxs[2] < bench_dist.absmin[i][2] )
+			continue;
+		list[count++] = bench_dist.ent[i];
+	}
+
+	if (node->axis == -1)
+		return count;
+	if (maxs[node->axis] > node->dist)
+		count = SV_BenchTreeQuery (node->children[0], mins, maxs, list, count, type);
+	if (mins[node->axis] < node->dist)
+		count = SV_BenchTreeQuery (node->children[1], mins, maxs, list, count, type);
+	return count;
+}
+
+/*
+===============
+SV_BenchLink
+
+Puts the recorded boxes in both the tree and a grid
+===============
+*/
+static void SV_BenchLink (void)
+{
+	int			i, n;
+	benchnode_t	*node;
+
+	bench_tree.numnodes = 0;
+	SV_BenchCreateNode (0, bench_dist.mins, bench_dist.maxs);
+	SV_ClearArea (&bench_grid, bench_dist.mins, bench_dist.maxs);
+
+	for (i=0 ; i<bench_dist.num ; i++)
+	{
+		for (n=0 ; ; )
+		{
+			node = &bench_tree.nodes[n];
+			if (node->axis == -1)
+				break;
+			if (bench_dist.absmin[i][node->axis] > node->dist)
+				n = node->children[0];
+			else if (bench_dist.absmax[i][node->axis] < node->dist)
+				n = node->children[1];
+			else
+				break;		// crosses the node
+		}
+		bench_tree.next[i] = node->first[bench_dist.type[i]-1];
+		node->first[bench_dist.type[i]-1] = i;
+
+		SV_AreaLink (&bench_grid, bench_dist.ent[i], bench_dist.absmin[i],
+			bench_dist.absmax[i], bench_dist.type[i]);
+	}
+}
+
+/*
+===============
+SV_RecordArea
+===============
+*/
+static void SV_RecordArea (void)
+{
+	int			e;
+	arealink_t	*l;
+
+	bench_dist.num = 0;
+	for (e=0, l=sv_area.links ; e<MAX_EDICTS ; e++, l++)
+	{
+		if (l->cell == -1)
+			continue;
+		bench_dist.ent[bench_dist.num] = e;
+		bench_dist.type[bench_dist.num] = l->type;
+		VectorCopy (l->absmin, bench_dist.absmin[bench_dist.num]);
+		VectorCopy (l->absmax, bench_dist.absmax[bench_dist.num]);
+		bench_dist.num++;
+	}
+	VectorCopy (sv.worldmodel->mins, bench_dist.mins);
+	VectorCopy (sv.worldmodel->maxs, bench_dist.maxs);
+}
+
+/*
+===============
+SV_WriteAreaDist
+===============
+*/
+static void SV_WriteAreaDist (char *name)
+{
+	FILE	*f;
+	int		i;
+
+	Con_Printf ("Writing %s.\n", name);
+	f = fopen (name, "w");
+	if (!f)
+	{
+		Con_Printf ("Couldn't open %s\n", name);
+		return;
+	}
+	fprintf (f, "%f %f %f %f %f %f\n", bench_dist.mins[0], bench_dist.mins[1],
+		bench_dist.mins[2], bench_dist.maxs[0], bench_dist.maxs[1], bench_dist.maxs[2]);
+	for (i=0 ; i<bench_dist.num ; i++)
+		fprintf (f, "%i %i %f %f %f %f %f %f\n", bench_dist.ent[i], bench_dist.type[i],
+			bench_dist.absmin[i][0], bench_dist.absmin[i][1], bench_dist.absmin[i][2],
+			bench_dist.absmax[i][0], bench_dist.absmax[i][1], bench_dist.absmax[i][2]);
+	fclose (f);
+}
+
+/*
+===============
+SV_ReadAreaDist
+===============
+*/
+static qboolean SV_ReadAreaDist (char *name)
+{
+	FILE	*f;
+	int		e, type;
+	float	*mins, *maxs;
+
+	f = fopen (name, "r");
+	if (!f)
+	{
+		Con_Printf ("Couldn't open %s\n", name);
+		return false;
+	}
+	mins = bench_dist.mins;
+	maxs = bench_dist.maxs;
+	if (fscanf (f, "%f %f %f %f %f %f", &mins[0], &mins[1], &mins[2],
+		&maxs[0], &maxs[1], &maxs[2]) != 6)
+	{
+		fclose (f);
+		Con_Printf ("%s is not an area recording\n", name);
+		return false;
+	}
+	bench_dist.num = 0;
+	while (bench_dist.num < MAX_EDICTS)
+	{
+		mins = bench_dist.absmin[bench_dist.num];
+		maxs = bench_dist.absmax[bench_dist.num];
+		if (fscanf (f, "%i %i %f %f %f %f %f %f", &e, &type, &mins[0], &mins[1],
+			&mins[2], &maxs[0], &maxs[1], &maxs[2]) != 8)
+			break;
+		if (e < 0 || e >= MAX_EDICTS || (type != AREA_SOLID && type != AREA_TRIGGERS))
+			continue;
+		bench_dist.ent[bench_dist.num] = e;
+		bench_dist.type[bench_dist.num] = type;
+		bench_dist.num++;
+	}
+	fclose (f);
+	return true;
+}
+
+/*
+===============
+SV_AreaBench_f
+
+"areabench record <file>" saves where the entities of the running map
+are linked.  "areabench [file] [count]" runs queries like those of player
+moves, touches and missile moves over that recording, or the running map,
+through the grid and the old areanode tree, and checks they find the
+same entities.
+===============
+*/
+void SV_AreaBench_f (void)
+{
+	char		name[MAX_OSPATH];
+	int			i, j, n, count, type, differ, found, c1, c2;
+	unsigned	seed;
+	vec3_t		*qmins, *qmaxs, mid;
+	short		list1[MAX_EDICTS], list2[MAX_EDICTS];
+	double		t, treetime, gridtime;
+
+	if (!strcmp (Cmd_Argv(1), "record"))
+	{
+		if (Cmd_Argc() != 3 || sv.state != ss_active)
+		{
+			Con_Printf ("areabench record <file> with a map running\n");
+			return;
+		}
+		if (!SV_BenchFileName (name, Cmd_Argv(2)))
+			return;
+		SV_RecordArea ();
+		SV_WriteAreaDist (name);
+		return;
+	}
+
+	if (Cmd_Argc() > 1 && !isdigit(Cmd_Argv(1)[0]))
+	{
+		if (!SV_BenchFileName (name, Cmd_Argv(1)) || !SV_ReadAreaDist (name))
+			return;
+		count = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 100000;
+	}
+	else
+	{
+		if (sv.state != ss_active)
+		{
+			Con_Printf ("areabench: no map running and no recording given\n");
+			return;
+		}
+		SV_RecordArea ();
+		count = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 100000;
+	}
+	if (!bench_dist.num)
+	{
+		Con_Printf ("areabench: no entities\n");
+		return;
+	}
+	if (count < 3)
+		count = 3;
+
+	qmins = malloc (count * sizeof(*qmins));
+	qmaxs = malloc (count * sizeof(*qmaxs));
+	if (!qmins || !qmaxs)
+	{
+		free (qmins);
+		free (qmaxs);
+		Con_Printf ("areabench: out of memory\n");
+		return;
+	}
+
+	SV_BenchLink ();
+
+	// around the entities in turn: the box a player move gathers from,
+	// the entity's own box as for touching triggers, and a missile's
+	// sweep in some direction
+	seed = 1;
+	for (n=0 ; n<count ; n++)
+	{
+		i = (n/3) % bench_dist.num;
+		VectorAdd (bench_dist.absmin[i], bench_dist.absmax[i], mid);
+		VectorScale (mid, 0.5, mid);
+		switch (n%3)
+		{
+		case 0:
+			for (j=0 ; j<3 ; j++)
+			{
+				qmins[n][j] = mid[j] - 256;
+				qmaxs[n][j] = mid[j] + 256;
+			}
+			break;
+		case 1:
+			VectorCopy (bench_dist.absmin[i], qmins[n]);
+			VectorCopy (bench_dist.absmax[i], qmaxs[n]);
+			break;
+		case 2:
+			for (j=0 ; j<3 ; j++)
+			{
+				seed = seed*1103515245 + 12345;
+				t = mid[j] + (int)((seed>>8)&1023) - 512;
+				qmins[n][j] = (t < mid[j] ? t : mid[j]) - 16;
+				qmaxs[n][j] = (t < mid[j] ? mid[j] : t) + 16;
+			}
+			break;
+		}
+	}
+
+	found = 0;
+	t = Sys_DoubleTime ();
+	for (n=0 ; n<count ; n++)
+		found += SV_BenchTreeQuery (0, qmins[n], qmaxs[n], list1, 0,
+			n%3 == 1 ? AREA_TRIGGERS : AREA_SOLID);
+	treetime = Sys_DoubleTime () - t;
+
+	t = Sys_DoubleTime ();
+	for (n=0 ; n<count ; n++)
+		SV_AreaQuery (&bench_grid, qmins[n], qmaxs[n], list2,
+			n%3 == 1 ? AREA_TRIGGERS : AREA_SOLID);
+	gridtime = Sys_DoubleTime () - t;
+
+	differ = 0;
+	for (n=0 ; n<count ; n++)
+	{
+		type = n%3 == 1 ? AREA_TRIGGERS : AREA_SOLID;
+		c1 = SV_BenchTreeQuery (0, qmins[n], qmaxs[n], list1, 0, type);
+		qsort (list1, c1, sizeof(short), SV_CompareShort);
+		c2 = SV_AreaQuery (&bench_grid, qmins[n], qmaxs[n], list2, type);
+		if (c1 != c2 || memcmp (list1, list2, c1*sizeof(short)))
+			differ++;
+	}
+
+	Con_Printf ("%i entities, %i queries: tree %.1f ns, grid %.1f ns a query, %.1f found, %i differ\n",
+		bench_dist.num, count, treetime*1e9/count, gridtime*1e9/count,
+		(float)found/count, differ);
+
+	free (qmins);
+	free (qmaxs);
+}
@@ -19,12 +19,6 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 // world.h
 
-typedef struct
-{
-	vec3_t	normal;
-	float	dist;
-} plane_t;
-
 typedef struct
 {
 	qboolean	allsolid;	// if true, plane is not valid
@@ -41,19 +35,8 @@ typedef struct
 #define	MOVE_NOMONSTERS	1
 #define	MOVE_MISSILE	2
 
-typedef struct areanode_s
-{
-	int		axis;		// -1 = leaf node
-	float	dist;
-	struct areanode_s	*children[2];
-	link_t	trigger_edicts;
-	link_t	solid_edicts;
-} areanode_t;
-
-#define	AREA_DEPTH	4
-#define	AREA_NODES	32
-
-extern	areanode_t	sv_areanodes[AREA_NODES];
+#define	AREA_SOLID		1
+#define	AREA_TRIGGERS	2
 
 
 void SV_ClearWorld (void);
@@ -70,12 +53,34 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers);
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+int SV_AreaEdicts (vec3_t mins, vec3_t maxs, edict_t **list, int maxcount, int areatype);
+// fills in the linked AREA_SOLID or AREA_TRIGGERS edicts whose boxes
+// touch mins/maxs, in entity order, and returns how many
+
+typedef struct
+{
+	int		links;			// SV_LinkEdict calls
+	int		leafskips;		// that kept their leafs without a descent
+	int		areaskips;		// that stayed in the same area cell
+} linkstats_t;
+
+extern	linkstats_t	sv_linkstats;
+
+int SV_AreaType (edict_t *ent);
+// AREA_SOLID or AREA_TRIGGERS as ent is linked, 0 if it isn't
+
+void SV_VisibleEntities (byte *pvs, byte *visents);
+// sets a bit in visents for every entity touching a leaf set in pvs
+
 int SV_PointContents (vec3_t p);
 // returns the CONTENTS_* value from the world at the given point.
 // does not check any entities at all
 
 edict_t	*SV_TestEntityPosition (edict_t *ent);
 
+void SV_TraceBench_f (void);
+void SV_AreaBench_f (void);
+
 trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict);
 // mins and maxs are reletive
 